@@ -323,3 +323,28 @@ void AH2Hash(const char *restrict bytes, size_t size, uint64_t hash[4])
 
 #undef d1
 #undef d2
+
+/* the Murmur3 finalizer, a bijection on 64-bit words */
+static inline uint64_t fmix64(uint64_t num)
+{
+  num ^= num >> 33;
+  num *= 0xff51afd7ed558ccd;
+  num ^= num >> 33;
+  num *= 0xc4ceb9fe1a85ec53;
+  num ^= num >> 33;
+  return num;
+}
+
+void AH2Fold(const uint64_t hash[4], uint64_t folded[2])
+{
+  /* two chains over the words in opposite orders, each a hash of all four */
+  uint64_t a = fmix64(hash[3]);
+  uint64_t b = fmix64(hash[0] ^ 0x9e3779b97f4a7c15);
+  a = fmix64(hash[2] ^ a);
+  b = fmix64(hash[1] ^ b);
+  a = fmix64(hash[1] ^ a);
+  b = fmix64(hash[2] ^ b);
+
+  folded[0] = fmix64(hash[0] ^ a);
+  folded[1] = fmix64(hash[3] ^ b);
+}
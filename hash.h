@@ -27,6 +27,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <stdbool.h>
 
 /*
  * A 128-bit non-cryptographic hash function for use in hash tables
@@ -49,5 +50,373 @@ void AH1Hash(const char *bytes, size_t size, uint32_t hash[4]);
  */
 void AH2Hash(const char *bytes, size_t size, uint64_t hash[4]);
 
+/*
+ * Folds an AH2Hash digest into 128 bits that depend on all four of its
+ * words. No single digest word, nor any xor of two, is safe to use alone
+ * as a key: on short keys they repeat while the whole digest does not.
+ *
+ * @param hash   a digest set by AH2Hash.
+ * @param folded an array of minimum size two, set to the folded value.
+ */
+void AH2Fold(const uint64_t hash[4], uint64_t folded[2]);
+
+/*
+ * An open-addressing hash table keyed by AH1Hash. Keys are not copied;
+ * the caller keeps them alive for as long as the table refers to them.
+ * Every key maps to a 64-bit value cell, zero when first inserted.
+ */
+typedef struct AH1Table AH1Table;
+
+/*
+ * Allocates a table large enough to hold capacity keys without growing.
+ *
+ * @param capacity expected number of keys, may be zero.
+ * @return a new table, or NULL if memory could not be allocated or a table
+ *         that large can not be addressed.
+ */
+AH1Table *AH1TableCreate(size_t capacity);
+
+/*
+ * Releases a table. Keys referred to by the table are left untouched.
+ *
+ * @param table the table to free, may be NULL.
+ */
+void AH1TableDestroy(AH1Table *table);
+
+/*
+ * @param table the table to query.
+ * @return number of keys stored in the table.
+ */
+size_t AH1TableSize(const AH1Table *table);
+
+/*
+ * Grows the table, if needed, so that count more keys can be inserted
+ * without another reallocation.
+ *
+ * @param table the table to grow.
+ * @param count number of keys about to be inserted.
+ * @return zero on success, -1 if memory could not be allocated or the
+ *         table would outgrow what can be addressed.
+ */
+int AH1TableReserve(AH1Table *table, size_t count);
+
+/*
+ * Looks up a key, inserting it with a zero value if it is missing. The
+ * returned cell stays valid until the table grows again.
+ *
+ * @param table the table to update.
+ * @param key   the bytes of the key.
+ * @param size  length of the key.
+ * @return the value cell of the key, or NULL if the table could not grow.
+ */
+uint64_t *AH1TableUpsert(AH1Table *table, const char *key, size_t size);
+
+/*
+ * @param table the table to query.
+ * @param key   the bytes of the key.
+ * @param size  length of the key.
+ * @return the value cell of the key, or NULL if the key is missing.
+ */
+uint64_t *AH1TableFind(const AH1Table *table, const char *key, size_t size);
+
+/*
+ * Batched AH1TableUpsert. Keys are hashed and their buckets prefetched a
+ * group at a time before any of them is probed, so that hashing overlaps
+ * with memory latency on tables larger than the cache. The table grows
+ * once up front, which keeps every cell of the batch valid together.
+ *
+ * @param table the table to update.
+ * @param keys  count pointers to key bytes.
+ * @param sizes count key lengths.
+ * @param count number of keys in the batch.
+ * @param cells an array of count pointers, set to the value cells.
+ * @return zero on success, -1 if the table could not grow.
+ */
+int AH1TableUpsertBulk(AH1Table *table, const char *const keys[],
+                       const size_t sizes[], size_t count, uint64_t *cells[]);
+
+/*
+ * Batched AH1TableFind, pipelined the same way as AH1TableUpsertBulk.
+ *
+ * @param table the table to query.
+ * @param keys  count pointers to key bytes.
+ * @param sizes count key lengths.
+ * @param count number of keys in the batch.
+ * @param cells an array of count pointers, set to the value cells or NULL
+ *              for missing keys.
+ */
+void AH1TableFindBulk(const AH1Table *table, const char *const keys[],
+                      const size_t sizes[], size_t count, uint64_t *cells[]);
+
+/*
+ * A lock-free hash map keyed by AH2Hash digests, safe to share between
+ * threads without locking. The top bits of the digest pick the bucket and
+ * 126 of the remaining bits are stored in place of the key, so keys are
+ * never compared in full. A value is immutable once inserted.
+ * Growing the map is shared between the threads that use it. A table it
+ * outgrows is freed once no call that could still be reading it is in
+ * progress, so a thread stalled inside a call delays that.
+ */
+typedef struct AH2Map AH2Map;
+
+/*
+ * Allocates a map large enough to hold capacity digests before its first
+ * resize.
+ *
+ * @param capacity expected number of digests, may be zero.
+ * @return a new map, or NULL if memory could not be allocated or a map
+ *         that large can not be addressed.
+ */
+AH2Map *AH2MapCreate(size_t capacity);
+
+/*
+ * Releases a map. Must not race with any other call on the same map.
+ *
+ * @param map the map to free, may be NULL.
+ */
+void AH2MapDestroy(AH2Map *map);
+
+/*
+ * @param map the map to query.
+ * @return number of distinct digests inserted so far.
+ */
+size_t AH2MapSize(AH2Map *map);
+
+/*
+ * Inserts a digest unless it is already present. Of several threads
+ * inserting the same digest at once, exactly one sees it as new.
+ *
+ * @param map    the map to update.
+ * @param digest an AH2Hash digest.
+ * @param value  the value to keep with the digest.
+ * @return one if the digest was added, zero if it was already present,
+ *         -1 if the map was full and could not grow.
+ */
+int AH2MapInsert(AH2Map *map, const uint64_t digest[4], uint64_t value);
+
+/*
+ * @param map    the map to query.
+ * @param digest an AH2Hash digest.
+ * @param value  set to the value of the digest when it is present, may be
+ *               NULL.
+ * @return whether the digest is present.
+ */
+bool AH2MapFind(AH2Map *map, const uint64_t digest[4], uint64_t *value);
+
+/*
+ * A minimal perfect hash function over a static set of keys, mapping each
+ * of n keys to its own index in [0, n). Both of its sub-hashes come from
+ * a single AH1Hash call, and most keys are resolved with one read of a
+ * byte-wide table. Keys outside the set map to arbitrary indices.
+ */
+typedef struct AH1Perfect AH1Perfect;
+
+/*
+ * Builds a function over distinct keys, partitioning them so that the
+ * partitions are built in parallel.
+ *
+ * @param keys    count pointers to key bytes.
+ * @param sizes   count key lengths.
+ * @param count   number of keys.
+ * @param threads number of threads to build with.
+ * @return a new function, or NULL if memory could not be allocated or
+ *         two keys share their AH1Hash value, as duplicate keys do.
+ */
+AH1Perfect *AH1PerfectBuild(const char *const keys[], const size_t sizes[],
+                            size_t count, int threads);
+
+/*
+ * Maps a function saved by AH1PerfectSave into memory.
+ *
+ * @param path the file to map.
+ * @return the function, or NULL if the file could not be mapped or is not
+ *         a function saved on a machine of the same byte order.
+ */
+AH1Perfect *AH1PerfectLoad(const char *path);
+
+/*
+ * Writes a function to a file that AH1PerfectLoad can map back.
+ *
+ * @param perfect the function to save.
+ * @param path    the file to write.
+ * @return zero on success, -1 on failure with errno set.
+ */
+int AH1PerfectSave(const AH1Perfect *perfect, const char *path);
+
+/*
+ * Releases a function, unmapping it if it was loaded.
+ *
+ * @param perfect the function to free, may be NULL.
+ */
+void AH1PerfectDestroy(AH1Perfect *perfect);
+
+/*
+ * @param perfect the function to query.
+ * @return number of keys the function was built over.
+ */
+size_t AH1PerfectKeys(const AH1Perfect *perfect);
+
+/*
+ * @param perfect the function to query.
+ * @return number of bytes the function takes, as saved or mapped.
+ */
+size_t AH1PerfectBytes(const AH1Perfect *perfect);
+
+/*
+ * @param perfect the function to evaluate.
+ * @param key     the bytes of the key.
+ * @param size    length of the key.
+ * @return the index of the key, below AH1PerfectKeys.
+ */
+uint64_t AH1PerfectIndex(const AH1Perfect *perfect, const char *key, size_t size);
+
+/*
+ * A HyperLogLog sketch estimating the number of distinct keys added to
+ * it. The register index and rank come straight from the AH2Hash digest,
+ * so adding a key costs one hash and at most one byte update. Small sets
+ * are kept sparse at a higher precision until that stops saving memory.
+ */
+typedef struct AH2Hll AH2Hll;
+
+/*
+ * @param precision log2 of the number of registers, from 4 to 18. The
+ *                  standard error is about 1.04 / sqrt(2^precision).
+ * @return a new, empty sketch, or NULL if precision is out of range or
+ *         memory could not be allocated.
+ */
+AH2Hll *AH2HllCreate(unsigned int precision);
+
+/*
+ * @param hll the sketch to free, may be NULL.
+ */
+void AH2HllDestroy(AH2Hll *hll);
+
+/*
+ * @param hll  the sketch to update.
+ * @param key  the bytes of the key.
+ * @param size length of the key.
+ * @return zero on success, -1 if memory could not be allocated.
+ */
+int AH2HllAdd(AH2Hll *hll, const char *key, size_t size);
+
+/*
+ * Adds a key that has already been hashed with AH2Hash.
+ *
+ * @param hll    the sketch to update.
+ * @param digest the AH2Hash digest of the key.
+ * @return zero on success, -1 if memory could not be allocated.
+ */
+int AH2HllAddDigest(AH2Hll *hll, const uint64_t digest[4]);
+
+/*
+ * Batched AH2HllAdd, hashing a group of keys before updating registers.
+ *
+ * @param hll   the sketch to update.
+ * @param keys  count pointers to key bytes.
+ * @param sizes count key lengths.
+ * @param count number of keys in the batch.
+ * @return zero on success, -1 if memory could not be allocated.
+ */
+int AH2HllAddBulk(AH2Hll *hll, const char *const keys[], const size_t sizes[],
+                  size_t count);
+
+/*
+ * Folds one sketch into another, so that it estimates the union of both.
+ *
+ * @param hll   the sketch to update.
+ * @param other a sketch of the same precision.
+ * @return zero on success, -1 if the precisions differ or memory could
+ *         not be allocated.
+ */
+int AH2HllMerge(AH2Hll *hll, const AH2Hll *other);
+
+/*
+ * @param hll the sketch to query.
+ * @return the estimated number of distinct keys added.
+ */
+double AH2HllEstimate(AH2Hll *hll);
+
+/*
+ * A MinHash signature of the byte shingles of a text, using one
+ * permutation hashing: each shingle is hashed once with AH2Hash, one part
+ * of the digest picks one of k bins and another is kept if it is the bin's
+ * smallest. Bins left empty borrow the value of a pseudo-randomly chosen
+ * filled bin, so short texts still give comparable signatures.
+ *
+ * @param text      the bytes to shingle.
+ * @param size      length of the text.
+ * @param width     bytes per shingle; shorter texts are one shingle.
+ * @param signature an array of k values, set to the signature.
+ * @param k         number of values in the signature.
+ * @return zero on success, -1 if memory could not be allocated.
+ */
+int AH2MinHash(const char *text, size_t size, unsigned int width,
+               uint64_t signature[], unsigned int k);
+
+/*
+ * @param a first MinHash signature.
+ * @param b second MinHash signature.
+ * @param k number of values in each signature.
+ * @return the estimated Jaccard similarity of the two shingle sets.
+ */
+double AH2MinHashSimilarity(const uint64_t a[], const uint64_t b[], unsigned int k);
+
+/*
+ * A 64-bit SimHash of the byte shingles of a text, each shingle hashed
+ * once with AH2Hash. Similar texts differ in few bits.
+ *
+ * @param text  the bytes to shingle.
+ * @param size  length of the text.
+ * @param width bytes per shingle; shorter texts are one shingle.
+ * @return the fingerprint.
+ */
+uint64_t AH2SimHash(const char *text, size_t size, unsigned int width);
+
+/*
+ * @param a first SimHash fingerprint.
+ * @param b second SimHash fingerprint.
+ * @return number of bits the fingerprints differ in.
+ */
+unsigned int AH2SimHashDistance(uint64_t a, uint64_t b);
+
+/*
+ * A locality-sensitive hashing index over MinHash signatures of
+ * bands * rows values. Documents whose signatures agree on all rows of
+ * any one band are returned as candidates for each other.
+ */
+typedef struct AH2Lsh AH2Lsh;
+
+/*
+ * @param bands number of bands signatures are split into.
+ * @param rows  number of signature values in each band.
+ * @return a new, empty index, or NULL if memory could not be allocated.
+ */
+AH2Lsh *AH2LshCreate(unsigned int bands, unsigned int rows);
+
+/*
+ * @param lsh the index to free, may be NULL.
+ */
+void AH2LshDestroy(AH2Lsh *lsh);
+
+/*
+ * @param lsh       the index to update.
+ * @param signature a MinHash signature of bands * rows values.
+ * @param doc       the identifier returned for this document.
+ * @return zero on success, -1 if memory could not be allocated.
+ */
+int AH2LshInsert(AH2Lsh *lsh, const uint64_t signature[], uint64_t doc);
+
+/*
+ * Collects the documents sharing at least one band with a signature.
+ *
+ * @param lsh        the index to query.
+ * @param signature  a MinHash signature of bands * rows values.
+ * @param candidates an array of max values, set to distinct candidates.
+ * @param max        room in candidates.
+ * @return number of distinct candidates written.
+ */
+size_t AH2LshQuery(const AH2Lsh *lsh, const uint64_t signature[],
+                   uint64_t candidates[], size_t max);
+
 #endif /* __AH1_H__ */
 
@@ -0,0 +1,366 @@
+/* -- hll.c
+ * HyperLogLog cardinality sketches fed by AH2Hash digests, with a sparse
+ * representation for small sets in the manner of HyperLogLog++.
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2025 Abhigyan <nourr@duck.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "hash.h"
+
+#include <math.h>
+#include <string.h>
+#include <stdbool.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CLZ64(n) (__builtin_clzll(n))
+#else
+static inline int CLZ64(uint64_t n)
+{
+  int zeros = 0;
+  while (!(n & ((uint64_t) 1 << 63))) {
+    n <<= 1;
+    zeros++;
+  }
+  return zeros;
+}
+#endif
+
+#define MIN_PRECISION 4
+#define MAX_PRECISION 18
+
+/* precision of the sparse representation; an entry packs a 25-bit index
+ * above a 6-bit rank, so sorting entries sorts them by index */
+#define SPARSE_PRECISION 25
+#define RANK_BITS 6
+
+/* sparse entries gathered before they are sorted into the list */
+#define BUFFER 256
+
+/* keys hashed at a time by the bulk path */
+#define GROUP_SIZE 16
+
+struct AH2Hll
+{
+  unsigned int precision;
+  uint8_t *registers;
+  uint32_t *sparse;
+  size_t sparse_count;
+  size_t sparse_cap;
+  uint32_t buffer[BUFFER];
+  size_t buffered;
+};
+
+/* bits that depend on all four digest words, which repeat on short keys */
+static inline uint64_t digest_bits(const uint64_t digest[4])
+{
+  uint64_t folded[2];
+  AH2Fold(digest, folded);
+  return folded[0];
+}
+
+/* index from the top bits, rank from the position of the next set bit */
+static inline uint8_t rank_of(uint64_t x, unsigned int precision)
+{
+  uint64_t rest = x << precision;
+  return rest ? (uint8_t) (CLZ64(rest) + 1) : (uint8_t) (64 - precision + 1);
+}
+
+static inline uint32_t sparse_entry(uint64_t x)
+{
+  uint32_t index = (uint32_t) (x >> (64 - SPARSE_PRECISION));
+  return (index << RANK_BITS) | rank_of(x, SPARSE_PRECISION);
+}
+
+/* the register and rank a sparse entry stands for at the dense precision */
+static inline void dense_of(const AH2Hll *hll, uint32_t entry, size_t *index, uint8_t *rank)
+{
+  unsigned int extra = SPARSE_PRECISION - hll->precision;
+  uint32_t sparse_index = entry >> RANK_BITS;
+  uint32_t low = sparse_index & (((uint32_t) 1 << extra) - 1);
+
+  *index = sparse_index >> extra;
+  if (low) {
+    *rank = (uint8_t) (CLZ64((uint64_t) low) - (64 - extra) + 1);
+  } else {
+    *rank = (uint8_t) (extra + (entry & ((1 << RANK_BITS) - 1)));
+  }
+}
+
+static inline void dense_update(AH2Hll *hll, size_t index, uint8_t rank)
+{
+  if (rank > hll->registers[index]) hll->registers[index] = rank;
+}
+
+static void dense_add_entry(AH2Hll *hll, uint32_t entry)
+{
+  size_t index;
+  uint8_t rank;
+  dense_of(hll, entry, &index, &rank);
+  dense_update(hll, index, rank);
+}
+
+static int to_dense(AH2Hll *hll)
+{
+  hll->registers = calloc((size_t) 1 << hll->precision, sizeof(uint8_t));
+  if (!hll->registers) return -1;
+
+  for (size_t i = 0; i < hll->sparse_count; ++i) dense_add_entry(hll, hll->sparse[i]);
+  for (size_t i = 0; i < hll->buffered; ++i) dense_add_entry(hll, hll->buffer[i]);
+
+  free(hll->sparse);
+  hll->sparse = NULL;
+  hll->sparse_count = hll->sparse_cap = 0;
+  hll->buffered = 0;
+  return 0;
+}
+
+static int by_entry(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+  return (x > y) - (x < y);
+}
+
+/* sorts the buffer into the list, keeping the highest rank per index */
+static int flush(AH2Hll *hll)
+{
+  if (!hll->buffered) return 0;
+  qsort(hll->buffer, hll->buffered, sizeof(uint32_t), by_entry);
+
+  size_t cap = hll->sparse_count + hll->buffered;
+  uint32_t *merged = malloc(cap * sizeof(uint32_t));
+  if (!merged) return -1;
+
+  size_t i = 0, j = 0, n = 0;
+  while (i < hll->sparse_count || j < hll->buffered) {
+    uint32_t next;
+    if (j == hll->buffered || (i < hll->sparse_count && hll->sparse[i] < hll->buffer[j]))
+      next = hll->sparse[i++];
+    else
+      next = hll->buffer[j++];
+
+    /* entries of one index are adjacent, ordered by rank */
+    if (n && merged[n - 1] >> RANK_BITS == next >> RANK_BITS) merged[n - 1] = next;
+    else merged[n++] = next;
+  }
+
+  free(hll->sparse);
+  hll->sparse = merged;
+  hll->sparse_count = n;
+  hll->sparse_cap = cap;
+  hll->buffered = 0;
+
+  /* dense registers take a byte each, sparse entries four */
+  if (n * sizeof(uint32_t) >= ((size_t) 1 << hll->precision)) return to_dense(hll);
+  return 0;
+}
+
+static inline int add_entry(AH2Hll *hll, uint32_t entry)
+{
+  /* flushing may turn the sketch dense */
+  if (!hll->registers && hll->buffered == BUFFER && flush(hll)) return -1;
+
+  if (hll->registers) {
+    dense_add_entry(hll, entry);
+    return 0;
+  }
+
+  hll->buffer[hll->buffered++] = entry;
+  return 0;
+}
+
+static inline int add_bits(AH2Hll *hll, uint64_t x)
+{
+  if (hll->registers) {
+    dense_update(hll, (size_t) (x >> (64 - hll->precision)), rank_of(x, hll->precision));
+    return 0;
+  }
+
+  return add_entry(hll, sparse_entry(x));
+}
+
+static void merge_registers(uint8_t *restrict into, const uint8_t *restrict from, size_t size)
+{
+  size_t i = 0;
+#if defined(__AVX2__)
+  for (; i + 32 <= size; i += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i *) (into + i));
+    __m256i b = _mm256_loadu_si256((const __m256i *) (from + i));
+    _mm256_storeu_si256((__m256i *) (into + i), _mm256_max_epu8(a, b));
+  }
+#elif defined(__SSE2__)
+  for (; i + 16 <= size; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *) (into + i));
+    __m128i b = _mm_loadu_si128((const __m128i *) (from + i));
+    _mm_storeu_si128((__m128i *) (into + i), _mm_max_epu8(a, b));
+  }
+#endif
+  for (; i < size; ++i) {
+    if (from[i] > into[i]) into[i] = from[i];
+  }
+}
+
+/* helpers of Ertl's improved estimator, "New cardinality estimation
+ * algorithms for HyperLogLog sketches", 2017 */
+static double sigma(double x)
+{
+  if (x == 1.0) return INFINITY;
+  double y = 1.0, z = x, previous;
+  do {
+    x *= x;
+    previous = z;
+    z += x * y;
+    y += y;
+  } while (z != previous);
+  return z;
+}
+
+static double tau(double x)
+{
+  if (x == 0.0 || x == 1.0) return 0.0;
+  double y = 1.0, z = 1.0 - x, previous;
+  do {
+    x = sqrt(x);
+    previous = z;
+    y *= 0.5;
+    z -= (1.0 - x) * (1.0 - x) * y;
+  } while (z != previous);
+  return z / 3.0;
+}
+
+/* estimates from a histogram of register values, which runs up to q + 1 */
+static double estimate(const size_t *histogram, unsigned int precision)
+{
+  double m = (double) ((uint64_t) 1 << precision);
+  unsigned int q = 64 - precision;
+
+  double z = m * tau(1.0 - histogram[q + 1] / m);
+  for (unsigned int k = q; k >= 1; --k) z = 0.5 * (z + histogram[k]);
+  z += m * sigma(histogram[0] / m);
+
+  return m * m / (2.0 * log(2.0) * z);
+}
+
+AH2Hll *AH2HllCreate(unsigned int precision)
+{
+  if (precision < MIN_PRECISION || precision > MAX_PRECISION) return NULL;
+
+  AH2Hll *hll = calloc(1, sizeof(AH2Hll));
+  if (!hll) return NULL;
+
+  hll->precision = precision;
+  return hll;
+}
+
+void AH2HllDestroy(AH2Hll *hll)
+{
+  if (!hll) return;
+  free(hll->registers);
+  free(hll->sparse);
+  free(hll);
+}
+
+int AH2HllAdd(AH2Hll *hll, const char *key, size_t size)
+{
+  uint64_t digest[4];
+  AH2Hash(key, size, digest);
+  return add_bits(hll, digest_bits(digest));
+}
+
+int AH2HllAddDigest(AH2Hll *hll, const uint64_t digest[4])
+{
+  return add_bits(hll, digest_bits(digest));
+}
+
+int AH2HllAddBulk(AH2Hll *hll, const char *const keys[], const size_t sizes[],
+                  size_t count)
+{
+  uint64_t bits[GROUP_SIZE];
+  for (size_t base = 0; base < count; base += GROUP_SIZE) {
+    size_t n = count - base < GROUP_SIZE ? count - base : GROUP_SIZE;
+
+    for (size_t i = 0; i < n; ++i) {
+      uint64_t digest[4];
+      AH2Hash(keys[base + i], sizes[base + i], digest);
+      bits[i] = digest_bits(digest);
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+      if (add_bits(hll, bits[i])) return -1;
+    }
+  }
+
+  return 0;
+}
+
+int AH2HllMerge(AH2Hll *hll, const AH2Hll *other)
+{
+  if (hll->precision != other->precision) return -1;
+
+  if (other->registers) {
+    if (!hll->registers && to_dense(hll)) return -1;
+    merge_registers(hll->registers, other->registers, (size_t) 1 << hll->precision);
+    return 0;
+  }
+
+  for (size_t i = 0; i < other->sparse_count; ++i) {
+    if (add_entry(hll, other->sparse[i])) return -1;
+  }
+  for (size_t i = 0; i < other->buffered; ++i) {
+    if (add_entry(hll, other->buffer[i])) return -1;
+  }
+
+  return 0;
+}
+
+double AH2HllEstimate(AH2Hll *hll)
+{
+  size_t histogram[66] = { 0 };
+
+  if (hll->registers) {
+    size_t m = (size_t) 1 << hll->precision;
+    for (size_t i = 0; i < m; ++i) histogram[hll->registers[i]]++;
+    return estimate(histogram, hll->precision);
+  }
+
+  /* without memory to sort them, buffered entries are left out */
+  flush(hll);
+  if (hll->registers) return AH2HllEstimate(hll);
+
+  /* a sparse sketch is a dense one at the sparse precision, mostly zero */
+  histogram[0] = ((size_t) 1 << SPARSE_PRECISION) - hll->sparse_count;
+  for (size_t i = 0; i < hll->sparse_count; ++i) {
+    histogram[hll->sparse[i] & ((1 << RANK_BITS) - 1)]++;
+  }
+
+  return estimate(histogram, SPARSE_PRECISION);
+}
+
+#undef CLZ64
+#undef MIN_PRECISION
+#undef MAX_PRECISION
+#undef SPARSE_PRECISION
+#undef RANK_BITS
+#undef BUFFER
+#undef GROUP_SIZE
@@ -0,0 +1,505 @@
+/* -- map.c
+ * Lock-free hash map keyed by AH2Hash digests, grown cooperatively by the
+ * threads that use it.
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2025 Abhigyan <nourr@duck.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "hash.h"
+
+#include <string.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define CPU_RELAX() __builtin_ia32_pause()
+#else
+#define CPU_RELAX() ((void) 0)
+#endif
+
+/* the low two bits of a slot word hold its state, the rest hold the top
+ * of the bucket word. a moved slot is frozen for the next table. */
+#define STATE(w)    ((w) & 3)
+#define EMPTY       0
+#define MOVED       1
+#define PENDING     2
+#define READY       3
+
+/* moved while empty: probes end here and carry on in the next table */
+#define MOVED_EMPTY 1
+/* moved after copying: probes skip it, the digest lives on in the next table */
+#define MOVED_FULL  5
+
+/* counters are striped over cache lines so inserts do not share one */
+#define STRIPES     64
+#define CACHE_LINE  64
+
+/* number of slots a helping thread migrates at once */
+#define CHUNK       1024
+
+/* smallest power of two number of slots a table is allocated with */
+#define MIN_SLOTS   (STRIPES * 64)
+
+/* calls in progress are counted in one of three rotating epochs */
+#define EPOCHS      3
+#define NOT_RETIRED UINT64_MAX
+
+typedef struct AH2MapSlot
+{
+  _Atomic uint64_t word;
+  _Atomic uint64_t check;
+  _Atomic uint64_t value;
+} AH2MapSlot;
+
+typedef struct AH2MapCounter
+{
+  _Alignas(CACHE_LINE) _Atomic size_t count;
+} AH2MapCounter;
+
+typedef struct AH2MapTable
+{
+  AH2MapCounter stripes[STRIPES];
+  AH2MapSlot *slots;
+  size_t mask;
+  unsigned int shift;
+  size_t stripe_limit;
+  _Atomic size_t claimed;
+  _Atomic size_t migrated;
+  _Atomic uint64_t retired;
+  struct AH2MapTable *_Atomic next;
+} AH2MapTable;
+
+/*
+ * Outgrown tables are freed by epochs. Every call is counted in the epoch
+ * it started in, on a stripe of its thread. The epoch moves on only once
+ * no call is left in the one before it, so a table retired in epoch e is
+ * out of every call's reach by epoch e + 2.
+ */
+struct AH2Map
+{
+  AH2MapCounter stripes[STRIPES];
+  AH2MapCounter active[EPOCHS][STRIPES];
+  _Atomic uint64_t epoch;
+  _Atomic bool reclaiming;
+  AH2MapTable *_Atomic first;
+  AH2MapTable *_Atomic root;
+};
+
+/* any byte of thread local storage tells threads apart */
+static _Thread_local char thread_mark;
+
+/* a digest as it is stored: word with its state bits clear, and check */
+typedef struct AH2MapKey
+{
+  uint64_t word;
+  uint64_t check;
+} AH2MapKey;
+
+/* 126 bits folded from all four digest words; on short keys the words
+ * repeat in ways that make any one or two of them unsafe alone */
+static inline AH2MapKey make_key(const uint64_t digest[4])
+{
+  uint64_t folded[2];
+  AH2Fold(digest, folded);
+  AH2MapKey key = { folded[0] & ~(uint64_t) 3, folded[1] };
+  return key;
+}
+
+/* bits right above the state bits, independent of the bucket bits */
+static inline size_t key_stripe(const AH2MapKey *key)
+{
+  return (size_t) (key->word >> 2) & (STRIPES - 1);
+}
+
+static inline size_t key_bucket(const AH2MapTable *table, const AH2MapKey *key)
+{
+  return (size_t) (key->word >> table->shift);
+}
+
+static void *alloc_aligned(size_t size)
+{
+  size = (size + CACHE_LINE - 1) & ~(size_t) (CACHE_LINE - 1);
+  void *p = aligned_alloc(CACHE_LINE, size);
+  if (p) memset(p, 0, size);
+  return p;
+}
+
+static AH2MapTable *table_new(size_t slots)
+{
+  if (!slots) return NULL;
+
+  unsigned int bits = 0;
+  while (((size_t) 1 << bits) < slots) bits++;
+  slots = (size_t) 1 << bits;
+
+  AH2MapTable *table = alloc_aligned(sizeof(AH2MapTable));
+  if (!table) return NULL;
+
+  table->slots = calloc(slots, sizeof(AH2MapSlot));
+  if (!table->slots) {
+    free(table);
+    return NULL;
+  }
+
+  for (int i = 0; i < STRIPES; ++i) atomic_init(&table->stripes[i].count, 0);
+  table->mask = slots - 1;
+  table->shift = 64 - bits;
+  /* a table grows once any stripe holds its share of half the slots */
+  table->stripe_limit = slots / 2 / STRIPES;
+  atomic_init(&table->claimed, 0);
+  atomic_init(&table->migrated, 0);
+  atomic_init(&table->retired, NOT_RETIRED);
+  atomic_init(&table->next, NULL);
+  return table;
+}
+
+/* smallest slot count that keeps keys under the load limit, 0 if no
+ * table that large can be addressed */
+static size_t slots_for(size_t keys)
+{
+  if (keys > SIZE_MAX / 4 / sizeof(AH2MapSlot)) return 0;
+
+  size_t slots = MIN_SLOTS;
+  while (slots / 2 < keys) slots *= 2;
+  return slots;
+}
+
+/* returns the table taking over from the given one, NULL if out of memory */
+static AH2MapTable *grow(AH2MapTable *table)
+{
+  AH2MapTable *next = atomic_load(&table->next);
+  if (next) return next;
+
+  AH2MapTable *fresh = table_new(2 * (table->mask + 1));
+  if (!fresh) return NULL;
+
+  if (!atomic_compare_exchange_strong(&table->next, &next, fresh)) {
+    free(fresh->slots);
+    free(fresh);
+    return next;
+  }
+
+  return fresh;
+}
+
+/* waits out an insert in progress, returning the slot word once settled */
+static inline uint64_t settle(AH2MapSlot *slot, uint64_t word)
+{
+  while (STATE(word) == PENDING) {
+    CPU_RELAX();
+    word = atomic_load(&slot->word);
+  }
+
+  return word;
+}
+
+/*
+ * Inserts into the given table or, once the digest's probe sequence runs
+ * into a moved slot, the table after it. A probe sequence that reaches an
+ * empty slot after a resize started seals it, so every later probe for the
+ * same digest follows into the same next table.
+ */
+static int table_insert(AH2MapTable *table, const AH2MapKey *key, uint64_t value)
+{
+  size_t stripe = key_stripe(key);
+
+  for (;;) {
+    size_t i = key_bucket(table, key);
+    bool sealed = false;
+
+    for (size_t n = 0; n <= table->mask && !sealed; ++n, i = (i + 1) & table->mask) {
+      AH2MapSlot *slot = &table->slots[i];
+      uint64_t word = atomic_load(&slot->word);
+
+      while (word == EMPTY) {
+        AH2MapTable *next = atomic_load(&table->next);
+        if (!next && atomic_load_explicit(&table->stripes[stripe].count,
+                                          memory_order_relaxed) >= table->stripe_limit)
+          next = grow(table);
+
+        if (next) {
+          if (atomic_compare_exchange_strong(&slot->word, &word, MOVED_EMPTY))
+            word = MOVED_EMPTY;
+          continue;
+        }
+
+        if (atomic_compare_exchange_strong(&slot->word, &word, key->word | PENDING)) {
+          atomic_store_explicit(&slot->check, key->check, memory_order_relaxed);
+          atomic_store_explicit(&slot->value, value, memory_order_relaxed);
+          atomic_store_explicit(&slot->word, key->word | READY, memory_order_release);
+          atomic_fetch_add_explicit(&table->stripes[stripe].count, 1,
+                                    memory_order_relaxed);
+          return 1;
+        }
+      }
+
+      if (word == MOVED_EMPTY) {
+        sealed = true;
+        break;
+      }
+
+      if (STATE(word) == MOVED || (word & ~(uint64_t) 3) != key->word) continue;
+
+      word = settle(slot, word);
+      if (STATE(word) == READY && atomic_load_explicit(&slot->check,
+                                                       memory_order_relaxed) == key->check)
+        return 0;
+    }
+
+    /* a table left without empty slots hands every probe to the next */
+    AH2MapTable *next = sealed ? atomic_load(&table->next) : grow(table);
+    if (!next) return -1;
+    table = next;
+  }
+}
+
+static bool table_find(AH2MapTable *table, const AH2MapKey *key, uint64_t *value)
+{
+  while (table) {
+    size_t i = key_bucket(table, key);
+
+    for (size_t n = 0; n <= table->mask; ++n, i = (i + 1) & table->mask) {
+      AH2MapSlot *slot = &table->slots[i];
+      uint64_t word = atomic_load(&slot->word);
+
+      /* once a resize started, the digest may have moved on from a slot
+       * before this one while this slot still waits for its chunk */
+      if (word == EMPTY) {
+        if (!atomic_load(&table->next)) return false;
+        break;
+      }
+      if (word == MOVED_EMPTY) break;
+      if (STATE(word) == MOVED || (word & ~(uint64_t) 3) != key->word) continue;
+
+      word = settle(slot, word);
+      if (STATE(word) == READY && atomic_load_explicit(&slot->check,
+                                                       memory_order_relaxed) == key->check) {
+        if (value) *value = atomic_load_explicit(&slot->value, memory_order_relaxed);
+        return true;
+      }
+    }
+
+    table = atomic_load(&table->next);
+  }
+
+  return false;
+}
+
+/* copies one slot into the next table, then freezes it */
+static bool migrate_slot(AH2MapSlot *slot, AH2MapTable *next)
+{
+  uint64_t word = atomic_load(&slot->word);
+  for (;;) {
+    if (word == EMPTY) {
+      if (atomic_compare_exchange_strong(&slot->word, &word, MOVED_EMPTY))
+        return true;
+      continue;
+    }
+
+    word = settle(slot, word);
+    if (STATE(word) == MOVED) return true;
+
+    AH2MapKey key = { word & ~(uint64_t) 3,
+                      atomic_load_explicit(&slot->check, memory_order_relaxed) };
+    uint64_t value = atomic_load_explicit(&slot->value, memory_order_relaxed);
+
+    /* values never change, so copying twice or racing an insert is harmless */
+    if (table_insert(next, &key, value) < 0) return false;
+
+    atomic_store(&slot->word, MOVED_FULL);
+    return true;
+  }
+}
+
+/* migrates one chunk of a table that has started growing */
+static void help(AH2Map *map, AH2MapTable *table)
+{
+  AH2MapTable *next = atomic_load(&table->next);
+  if (!next) return;
+
+  size_t slots = table->mask + 1;
+  size_t start = atomic_fetch_add(&table->claimed, CHUNK);
+  if (start < slots) {
+    size_t end = start + CHUNK < slots ? start + CHUNK : slots;
+    size_t done = 0;
+    for (size_t i = start; i < end; ++i) {
+      done += migrate_slot(&table->slots[i], next);
+    }
+
+    /* a slot that failed to copy stays readable here, so the table is
+     * simply never retired */
+    atomic_fetch_add(&table->migrated, done);
+  }
+
+  AH2MapTable *expected = table;
+  if (atomic_load(&table->migrated) == slots
+      && atomic_compare_exchange_strong(&map->root, &expected, next))
+    atomic_store(&table->retired, atomic_load(&map->epoch));
+}
+
+static inline size_t thread_stripe(void)
+{
+  return (size_t) (((uintptr_t) &thread_mark * 0x9e3779b97f4a7c15) >> 58)
+       & (STRIPES - 1);
+}
+
+/* counts a call in the current epoch, returning the epoch's index */
+static inline unsigned int enter(AH2Map *map, size_t stripe)
+{
+  for (;;) {
+    uint64_t epoch = atomic_load(&map->epoch);
+    atomic_fetch_add(&map->active[epoch % EPOCHS][stripe].count, 1);
+    if (atomic_load(&map->epoch) == epoch) return epoch % EPOCHS;
+    atomic_fetch_sub(&map->active[epoch % EPOCHS][stripe].count, 1);
+  }
+}
+
+static inline void leave(AH2Map *map, unsigned int index, size_t stripe)
+{
+  atomic_fetch_sub(&map->active[index][stripe].count, 1);
+}
+
+/* moves the epoch on when it can, then frees tables no call can reach */
+static void reclaim(AH2Map *map)
+{
+  if (atomic_load_explicit(&map->reclaiming, memory_order_relaxed)
+      || atomic_exchange(&map->reclaiming, true))
+    return;
+
+  uint64_t epoch = atomic_load(&map->epoch);
+  size_t lagging = 0;
+  for (int i = 0; i < STRIPES; ++i) {
+    lagging += atomic_load(&map->active[(epoch + EPOCHS - 1) % EPOCHS][i].count);
+  }
+  if (!lagging && atomic_compare_exchange_strong(&map->epoch, &epoch, epoch + 1))
+    epoch++;
+
+  AH2MapTable *table = atomic_load(&map->first);
+  while (table != atomic_load(&map->root)) {
+    uint64_t retired = atomic_load(&table->retired);
+    if (retired == NOT_RETIRED || retired + 2 > epoch) break;
+
+    AH2MapTable *next = atomic_load(&table->next);
+    free(table->slots);
+    free(table);
+    table = next;
+  }
+
+  atomic_store(&map->first, table);
+  atomic_store(&map->reclaiming, false);
+}
+
+AH2Map *AH2MapCreate(size_t capacity)
+{
+  AH2Map *map = alloc_aligned(sizeof(AH2Map));
+  if (!map) return NULL;
+
+  AH2MapTable *first = table_new(slots_for(capacity));
+  if (!first) {
+    free(map);
+    return NULL;
+  }
+
+  for (int i = 0; i < STRIPES; ++i) {
+    atomic_init(&map->stripes[i].count, 0);
+    for (int e = 0; e < EPOCHS; ++e) atomic_init(&map->active[e][i].count, 0);
+  }
+  atomic_init(&map->epoch, 0);
+  atomic_init(&map->reclaiming, false);
+  atomic_init(&map->first, first);
+  atomic_init(&map->root, first);
+  return map;
+}
+
+void AH2MapDestroy(AH2Map *map)
+{
+  if (!map) return;
+
+  /* tables not yet reclaimed stay chained behind the first one */
+  AH2MapTable *table = atomic_load(&map->first);
+  while (table) {
+    AH2MapTable *next = atomic_load(&table->next);
+    free(table->slots);
+    free(table);
+    table = next;
+  }
+
+  free(map);
+}
+
+size_t AH2MapSize(AH2Map *map)
+{
+  size_t size = 0;
+  for (int i = 0; i < STRIPES; ++i) {
+    size += atomic_load_explicit(&map->stripes[i].count, memory_order_relaxed);
+  }
+
+  return size;
+}
+
+int AH2MapInsert(AH2Map *map, const uint64_t digest[4], uint64_t value)
+{
+  AH2MapKey key = make_key(digest);
+  size_t stripe = thread_stripe();
+  unsigned int epoch = enter(map, stripe);
+
+  AH2MapTable *root = atomic_load(&map->root);
+  help(map, root);
+  if (atomic_load(&map->first) != root) reclaim(map);
+
+  int added = table_insert(root, &key, value);
+  if (added == 1)
+    atomic_fetch_add_explicit(&map->stripes[key_stripe(&key)].count, 1,
+                              memory_order_relaxed);
+
+  leave(map, epoch, stripe);
+  return added;
+}
+
+bool AH2MapFind(AH2Map *map, const uint64_t digest[4], uint64_t *value)
+{
+  AH2MapKey key = make_key(digest);
+  size_t stripe = thread_stripe();
+  unsigned int epoch = enter(map, stripe);
+
+  AH2MapTable *root = atomic_load(&map->root);
+  help(map, root);
+  if (atomic_load(&map->first) != root) reclaim(map);
+
+  bool found = table_find(root, &key, value);
+  leave(map, epoch, stripe);
+  return found;
+}
+
+#undef CPU_RELAX
+#undef STATE
+#undef EMPTY
+#undef MOVED
+#undef PENDING
+#undef READY
+#undef MOVED_EMPTY
+#undef MOVED_FULL
+#undef STRIPES
+#undef CACHE_LINE
+#undef CHUNK
+#undef MIN_SLOTS
+#undef EPOCHS
+#undef NOT_RETIRED
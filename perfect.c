@@ -0,0 +1,697 @@
+/* -- perfect.c
+ * Minimal perfect hash functions over static key sets, in the manner of
+ * PTHash: keys are split into buckets, and each bucket searches for a
+ * pilot value that moves all of its keys to free slots at once.
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2025 Abhigyan <nourr@duck.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "hash.h"
+
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define MAGIC "AH1MPHF1"
+#define BYTE_ORDER_MARK 0x0102030405060708
+
+/* average number of keys in an independently built partition */
+#define PARTITION_KEYS (1 << 16)
+
+/* a partition of n keys has BUCKET_C * n / log2(n) buckets */
+#define BUCKET_C 5.0
+
+/* fraction of slots filled; keys landing past the last index are remapped */
+#define ALPHA 0.99
+
+/* 60% of keys go to the first 30% of buckets, which speeds up the search */
+#define DENSE_KEYS ((uint32_t) (0.6 * 4294967296.0))
+#define DENSE_BUCKETS 0.3
+
+/* a pilot byte that sends the lookup to the exception list */
+#define ESCAPE 255
+
+/* the file layout is the in-memory layout: header, partitions, exceptions,
+ * remapped slots and pilots, each array aligned to eight bytes */
+typedef struct AH1PerfectHeader
+{
+  char magic[8];
+  uint64_t order;
+  uint64_t keys;
+  uint64_t partitions;
+  uint64_t buckets;
+  uint64_t exceptions;
+  uint64_t remapped;
+} AH1PerfectHeader;
+
+typedef struct AH1PerfectPart
+{
+  uint64_t offset;
+  uint64_t pilots;
+  uint64_t remapped;
+  uint64_t exceptions;
+  uint32_t exception_count;
+  uint32_t keys;
+  uint32_t slots;
+  uint32_t buckets;
+  uint32_t dense;
+  uint32_t unused;
+} AH1PerfectPart;
+
+/* buckets are numbered within their partition */
+typedef struct AH1PerfectException
+{
+  uint32_t bucket;
+  uint32_t pilot;
+} AH1PerfectException;
+
+struct AH1Perfect
+{
+  char *base;
+  size_t bytes;
+  bool mapped;
+  const AH1PerfectHeader *header;
+  const AH1PerfectPart *parts;
+  const AH1PerfectException *exceptions;
+  const uint32_t *remapped;
+  const uint8_t *pilots;
+};
+
+/* state shared by the threads building one function */
+typedef struct Builder
+{
+  const char *const *keys;
+  const size_t *sizes;
+  size_t count;
+  int threads;
+
+  uint64_t *h1;
+  uint64_t *h2;
+  size_t *starts;
+  size_t partitions;
+
+  AH1PerfectPart *parts;
+  uint8_t **pilots;
+  AH1PerfectException **exceptions;
+  size_t *exception_counts;
+  uint32_t **remapped;
+
+  atomic_size_t next;
+  atomic_bool failed;
+} Builder;
+
+typedef struct Worker
+{
+  pthread_t thread;
+  Builder *builder;
+  int index;
+} Worker;
+
+static inline size_t align8(size_t size)
+{
+  return (size + 7) & ~(size_t) 7;
+}
+
+/* moves at past count items of size bytes, false if that would wrap */
+static inline bool skip(size_t *at, uint64_t count, size_t size)
+{
+  if (*at > SIZE_MAX - 7 || count > (SIZE_MAX - 7 - *at) / size) return false;
+  *at += align8(count * size);
+  return true;
+}
+
+/* offsets of the arrays that follow the header, returns the total bytes,
+ * or SIZE_MAX when a header read from a file sizes them past memory */
+static size_t layout(const AH1PerfectHeader *header, size_t offsets[4])
+{
+  size_t at = align8(sizeof(AH1PerfectHeader));
+  offsets[0] = at;
+  if (!skip(&at, header->partitions, sizeof(AH1PerfectPart))) return SIZE_MAX;
+  offsets[1] = at;
+  if (!skip(&at, header->exceptions, sizeof(AH1PerfectException))) return SIZE_MAX;
+  offsets[2] = at;
+  if (!skip(&at, header->remapped, sizeof(uint32_t))) return SIZE_MAX;
+  offsets[3] = at;
+  if (!skip(&at, header->buckets, sizeof(uint8_t))) return SIZE_MAX;
+  return at;
+}
+
+/* points the arrays into base, which already holds the header */
+static void attach(AH1Perfect *perfect)
+{
+  size_t offsets[4];
+  perfect->header = (const AH1PerfectHeader *) perfect->base;
+  layout(perfect->header, offsets);
+  perfect->parts = (const AH1PerfectPart *) (perfect->base + offsets[0]);
+  perfect->exceptions = (const AH1PerfectException *) (perfect->base + offsets[1]);
+  perfect->remapped = (const uint32_t *) (perfect->base + offsets[2]);
+  perfect->pilots = (const uint8_t *) (perfect->base + offsets[3]);
+}
+
+/* every partition of a loaded file must stay within the arrays the header
+ * sizes, and its remapped slots within its own keys */
+static bool parts_valid(const AH1Perfect *perfect)
+{
+  const AH1PerfectHeader *header = perfect->header;
+  for (uint64_t i = 0; i < header->partitions; ++i) {
+    const AH1PerfectPart *part = &perfect->parts[i];
+    uint64_t spare = (uint64_t) part->slots - part->keys;
+    if (part->slots < part->keys || part->dense > part->buckets ||
+        (part->keys && !part->dense) ||
+        part->offset > header->keys || part->keys > header->keys - part->offset ||
+        part->pilots > header->buckets ||
+        part->buckets > header->buckets - part->pilots ||
+        part->remapped > header->remapped ||
+        spare > header->remapped - part->remapped ||
+        part->exceptions > header->exceptions ||
+        part->exception_count > header->exceptions - part->exceptions)
+      return false;
+
+    for (uint64_t j = 0; j < spare; ++j) {
+      if (perfect->remapped[part->remapped + j] >= part->keys) return false;
+    }
+  }
+
+  return true;
+}
+
+static inline void key_hashes(const char *key, size_t size, uint64_t *h1, uint64_t *h2)
+{
+  uint32_t hash[4];
+  AH1Hash(key, size, hash);
+  *h1 = ((uint64_t) hash[0] << 32) | hash[1];
+  *h2 = ((uint64_t) hash[2] << 32) | hash[3];
+}
+
+/* the top half of h1 picks the partition, the bottom half the bucket */
+static inline size_t partition_of(uint64_t h1, size_t partitions)
+{
+  return (size_t) (((h1 >> 32) * partitions) >> 32);
+}
+
+static inline uint32_t bucket_of(const AH1PerfectPart *part, uint64_t h1)
+{
+  uint32_t h = (uint32_t) h1;
+  if (h < DENSE_KEYS || part->dense == part->buckets) return h % part->dense;
+  return part->dense + h % (part->buckets - part->dense);
+}
+
+static inline uint64_t pilot_hash(uint64_t pilot)
+{
+  /* splitmix64 finalizer, so neighbouring pilots land far apart */
+  uint64_t x = pilot + 0x9e3779b97f4a7c15;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+  return x ^ (x >> 31);
+}
+
+static inline uint32_t slot_of(const AH1PerfectPart *part, uint64_t h2, uint64_t pilot)
+{
+  return (uint32_t) ((h2 ^ pilot_hash(pilot)) % part->slots);
+}
+
+static uint64_t pilot_of(const AH1Perfect *perfect, const AH1PerfectPart *part,
+                         uint32_t bucket)
+{
+  uint8_t pilot = perfect->pilots[part->pilots + bucket];
+  if (pilot != ESCAPE) return pilot;
+
+  const AH1PerfectException *exceptions = perfect->exceptions + part->exceptions;
+  size_t low = 0, high = part->exception_count;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (exceptions[mid].bucket < bucket) low = mid + 1;
+    else high = mid;
+  }
+
+  return exceptions[low].pilot;
+}
+
+static inline bool test_bit(const uint64_t *bits, uint32_t i)
+{
+  return (bits[i >> 6] >> (i & 63)) & 1;
+}
+
+static int by_bucket(const void *a, const void *b)
+{
+  uint32_t x = ((const AH1PerfectException *) a)->bucket;
+  uint32_t y = ((const AH1PerfectException *) b)->bucket;
+  return (x > y) - (x < y);
+}
+
+/* searches a pilot for every bucket of one partition */
+static int build_part(Builder *builder, size_t index)
+{
+  AH1PerfectPart *part = &builder->parts[index];
+  const uint64_t *h1 = builder->h1 + builder->starts[index];
+  const uint64_t *h2 = builder->h2 + builder->starts[index];
+  size_t n = part->keys;
+  if (!n) return 0;
+
+  double bits = n > 2 ? log2((double) n) : 1.0;
+  part->slots = (uint32_t) ceil(n / ALPHA);
+  if (part->slots < n) part->slots = n;
+  part->buckets = (uint32_t) ceil(BUCKET_C * n / bits);
+  part->dense = part->buckets > 1 ? (uint32_t) (DENSE_BUCKETS * part->buckets) : 1;
+  if (!part->dense) part->dense = 1;
+
+  int err = -1;
+  uint32_t *starts = calloc(part->buckets + 1, sizeof(uint32_t));
+  uint64_t *sorted = malloc(n * sizeof(uint64_t));
+  uint64_t *taken = calloc((part->slots + 63) / 64, sizeof(uint64_t));
+  uint32_t *order = NULL, *sizes = NULL, *slots = NULL;
+  uint8_t *pilots = calloc(part->buckets, sizeof(uint8_t));
+  uint32_t *remapped = malloc(((size_t) part->slots - n + 1) * sizeof(uint32_t));
+  AH1PerfectException *exceptions = NULL;
+  size_t exception_count = 0, exception_cap = 0;
+  if (!starts || !sorted || !taken || !pilots || !remapped) goto done;
+
+  /* counting sort of the keys by bucket */
+  for (size_t k = 0; k < n; ++k) starts[bucket_of(part, h1[k]) + 1]++;
+  uint32_t largest = 0;
+  for (uint32_t b = 0; b < part->buckets; ++b) {
+    if (starts[b + 1] > largest) largest = starts[b + 1];
+    starts[b + 1] += starts[b];
+  }
+  for (size_t k = 0; k < n; ++k) {
+    uint32_t b = bucket_of(part, h1[k]);
+    sorted[--starts[b + 1]] = h2[k];
+  }
+  /* starts[b + 1] now points at bucket b; shift back into place */
+  memmove(starts, starts + 1, part->buckets * sizeof(uint32_t));
+  starts[part->buckets] = n;
+
+  /* buckets are placed largest first, while free slots are plentiful */
+  sizes = calloc(largest + 2, sizeof(uint32_t));
+  order = malloc(part->buckets * sizeof(uint32_t));
+  slots = malloc((largest + 1) * sizeof(uint32_t));
+  if (!sizes || !order || !slots) goto done;
+
+  for (uint32_t b = 0; b < part->buckets; ++b) {
+    sizes[largest - (starts[b + 1] - starts[b]) + 1]++;
+  }
+  for (uint32_t s = 0; s <= largest; ++s) sizes[s + 1] += sizes[s];
+  for (uint32_t b = 0; b < part->buckets; ++b) {
+    order[sizes[largest - (starts[b + 1] - starts[b])]++] = b;
+  }
+
+  for (uint32_t i = 0; i < part->buckets; ++i) {
+    uint32_t b = order[i];
+    const uint64_t *bucket = sorted + starts[b];
+    uint32_t size = starts[b + 1] - starts[b];
+    if (!size) break;
+
+    /* keys sharing a bucket and h2 can never be told apart */
+    for (uint32_t j = 0; j < size; ++j) {
+      for (uint32_t k = j + 1; k < size; ++k) {
+        if (bucket[j] == bucket[k]) goto done;
+      }
+    }
+
+    uint64_t pilot;
+    for (pilot = 0; pilot <= UINT32_MAX; ++pilot) {
+      if (atomic_load_explicit(&builder->failed, memory_order_relaxed)) goto done;
+
+      uint64_t hash = pilot_hash(pilot);
+      uint32_t j;
+      for (j = 0; j < size; ++j) {
+        uint32_t slot = (uint32_t) ((bucket[j] ^ hash) % part->slots);
+        if (test_bit(taken, slot)) break;
+        taken[slot >> 6] |= (uint64_t) 1 << (slot & 63);
+        slots[j] = slot;
+      }
+
+      if (j == size) break;
+      while (j--) taken[slots[j] >> 6] &= ~((uint64_t) 1 << (slots[j] & 63));
+    }
+
+    if (pilot > UINT32_MAX) goto done;
+
+    if (pilot < ESCAPE) {
+      pilots[b] = (uint8_t) pilot;
+      continue;
+    }
+
+    pilots[b] = ESCAPE;
+    if (exception_count == exception_cap) {
+      exception_cap = exception_cap ? 2 * exception_cap : 64;
+      AH1PerfectException *grown = realloc(exceptions, exception_cap * sizeof(*grown));
+      if (!grown) goto done;
+      exceptions = grown;
+    }
+    exceptions[exception_count].bucket = b;
+    exceptions[exception_count].pilot = (uint32_t) pilot;
+    exception_count++;
+  }
+
+  qsort(exceptions, exception_count, sizeof(*exceptions), by_bucket);
+
+  /* slots past the last index point at the free slots below it */
+  uint32_t free_slot = 0;
+  for (uint32_t slot = n; slot < part->slots; ++slot) {
+    remapped[slot - n] = 0;
+    if (!test_bit(taken, slot)) continue;
+    while (test_bit(taken, free_slot)) free_slot++;
+    remapped[slot - n] = free_slot++;
+  }
+
+  builder->pilots[index] = pilots;
+  builder->remapped[index] = remapped;
+  builder->exceptions[index] = exceptions;
+  builder->exception_counts[index] = exception_count;
+  pilots = NULL;
+  remapped = NULL;
+  exceptions = NULL;
+  err = 0;
+
+done:
+  free(starts);
+  free(sorted);
+  free(taken);
+  free(order);
+  free(sizes);
+  free(slots);
+  free(pilots);
+  free(remapped);
+  free(exceptions);
+  return err;
+}
+
+static void *hash_worker(void *arg)
+{
+  Worker *worker = arg;
+  Builder *builder = worker->builder;
+  size_t begin = builder->count * worker->index / builder->threads;
+  size_t end = builder->count * (worker->index + 1) / builder->threads;
+
+  for (size_t k = begin; k < end; ++k) {
+    key_hashes(builder->keys[k], builder->sizes[k], &builder->h1[k], &builder->h2[k]);
+  }
+
+  return NULL;
+}
+
+static void *part_worker(void *arg)
+{
+  Builder *builder = ((Worker *) arg)->builder;
+  for (;;) {
+    size_t i = atomic_fetch_add(&builder->next, 1);
+    if (i >= builder->partitions || atomic_load(&builder->failed)) break;
+    if (build_part(builder, i)) atomic_store(&builder->failed, true);
+  }
+
+  return NULL;
+}
+
+/* runs fn on every worker, or inline when there is only one */
+static int run_workers(Builder *builder, void *(*fn)(void *))
+{
+  Worker *workers = calloc(builder->threads, sizeof(Worker));
+  if (!workers) return -1;
+
+  int started = 0;
+  for (int t = 0; t < builder->threads; ++t) {
+    workers[t].builder = builder;
+    workers[t].index = t;
+  }
+  for (int t = 1; t < builder->threads; ++t, ++started) {
+    if (pthread_create(&workers[t].thread, NULL, fn, &workers[t])) break;
+  }
+
+  fn(&workers[0]);
+  for (int t = 1; t <= started; ++t) pthread_join(workers[t].thread, NULL);
+
+  /* work left by threads that failed to start is picked up here */
+  for (int t = started + 1; t < builder->threads; ++t) fn(&workers[t]);
+
+  free(workers);
+  return 0;
+}
+
+static AH1Perfect *assemble(Builder *builder)
+{
+  size_t buckets = 0, exceptions = 0, remapped = 0;
+  for (size_t i = 0; i < builder->partitions; ++i) {
+    AH1PerfectPart *part = &builder->parts[i];
+    part->offset = builder->starts[i];
+    part->pilots = buckets;
+    part->remapped = remapped;
+    part->exceptions = exceptions;
+    part->exception_count = (uint32_t) builder->exception_counts[i];
+    buckets += part->buckets;
+    exceptions += builder->exception_counts[i];
+    remapped += part->slots - part->keys;
+  }
+
+  AH1PerfectHeader header = { MAGIC, BYTE_ORDER_MARK, builder->count,
+                              builder->partitions, buckets, exceptions, remapped };
+
+  size_t offsets[4];
+  AH1Perfect *perfect = calloc(1, sizeof(AH1Perfect));
+  if (!perfect) return NULL;
+  perfect->bytes = layout(&header, offsets);
+  perfect->base = calloc(perfect->bytes, 1);
+  if (!perfect->base) {
+    free(perfect);
+    return NULL;
+  }
+
+  memcpy(perfect->base, &header, sizeof(header));
+  attach(perfect);
+  memcpy((void *) perfect->parts, builder->parts,
+         builder->partitions * sizeof(AH1PerfectPart));
+
+  for (size_t i = 0; i < builder->partitions; ++i) {
+    const AH1PerfectPart *part = &builder->parts[i];
+    memcpy((AH1PerfectException *) perfect->exceptions + part->exceptions,
+           builder->exceptions[i], part->exception_count * sizeof(AH1PerfectException));
+
+    if (part->keys) {
+      memcpy((uint8_t *) perfect->pilots + part->pilots, builder->pilots[i], part->buckets);
+      memcpy((uint32_t *) perfect->remapped + part->remapped, builder->remapped[i],
+             (part->slots - part->keys) * sizeof(uint32_t));
+    }
+  }
+
+  return perfect;
+}
+
+static void builder_free(Builder *builder)
+{
+  for (size_t i = 0; i < builder->partitions; ++i) {
+    if (builder->pilots) free(builder->pilots[i]);
+    if (builder->remapped) free(builder->remapped[i]);
+    if (builder->exceptions) free(builder->exceptions[i]);
+  }
+
+  free(builder->h1);
+  free(builder->h2);
+  free(builder->starts);
+  free(builder->parts);
+  free(builder->pilots);
+  free(builder->remapped);
+  free(builder->exceptions);
+  free(builder->exception_counts);
+}
+
+AH1Perfect *AH1PerfectBuild(const char *const keys[], const size_t sizes[],
+                            size_t count, int threads)
+{
+  Builder builder = { 0 };
+  builder.keys = keys;
+  builder.sizes = sizes;
+  builder.count = count;
+  builder.partitions = (count + PARTITION_KEYS - 1) / PARTITION_KEYS;
+  if (!builder.partitions) builder.partitions = 1;
+  builder.threads = threads < 1 ? 1 : threads;
+  atomic_init(&builder.next, 0);
+  atomic_init(&builder.failed, false);
+
+  AH1Perfect *perfect = NULL;
+  uint64_t *h1 = NULL, *h2 = NULL;
+  builder.h1 = malloc((count + 1) * sizeof(uint64_t));
+  builder.h2 = malloc((count + 1) * sizeof(uint64_t));
+  builder.starts = calloc(builder.partitions + 1, sizeof(size_t));
+  builder.parts = calloc(builder.partitions, sizeof(AH1PerfectPart));
+  builder.pilots = calloc(builder.partitions, sizeof(uint8_t *));
+  builder.remapped = calloc(builder.partitions, sizeof(uint32_t *));
+  builder.exceptions = calloc(builder.partitions, sizeof(AH1PerfectException *));
+  builder.exception_counts = calloc(builder.partitions, sizeof(size_t));
+  if (!builder.h1 || !builder.h2 || !builder.starts || !builder.parts ||
+      !builder.pilots || !builder.remapped || !builder.exceptions ||
+      !builder.exception_counts)
+    goto done;
+
+  /* hash every key once, then group the hashes by partition */
+  if (run_workers(&builder, hash_worker)) goto done;
+
+  h1 = malloc((count + 1) * sizeof(uint64_t));
+  h2 = malloc((count + 1) * sizeof(uint64_t));
+  if (!h1 || !h2) goto done;
+
+  for (size_t k = 0; k < count; ++k) {
+    builder.starts[partition_of(builder.h1[k], builder.partitions) + 1]++;
+  }
+  for (size_t i = 0; i < builder.partitions; ++i) {
+    builder.parts[i].keys = (uint32_t) builder.starts[i + 1];
+    builder.starts[i + 1] += builder.starts[i];
+  }
+  for (size_t k = 0; k < count; ++k) {
+    size_t i = partition_of(builder.h1[k], builder.partitions);
+    size_t at = builder.starts[i] + --builder.parts[i].keys;
+    h1[at] = builder.h1[k];
+    h2[at] = builder.h2[k];
+  }
+  for (size_t i = 0; i < builder.partitions; ++i) {
+    builder.parts[i].keys = (uint32_t) (builder.starts[i + 1] - builder.starts[i]);
+  }
+
+  free(builder.h1);
+  free(builder.h2);
+  builder.h1 = h1;
+  builder.h2 = h2;
+  h1 = h2 = NULL;
+
+  if (builder.threads > (int) builder.partitions) builder.threads = builder.partitions;
+  if (run_workers(&builder, part_worker) || atomic_load(&builder.failed)) goto done;
+
+  perfect = assemble(&builder);
+
+done:
+  free(h1);
+  free(h2);
+  builder_free(&builder);
+  return perfect;
+}
+
+AH1Perfect *AH1PerfectLoad(const char *path)
+{
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) return NULL;
+
+  struct stat st;
+  if (fstat(fd, &st) == -1 || (size_t) st.st_size < sizeof(AH1PerfectHeader)) {
+    close(fd);
+    return NULL;
+  }
+
+  char *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) return NULL;
+
+  AH1Perfect *perfect = calloc(1, sizeof(AH1Perfect));
+  const AH1PerfectHeader *header = (const AH1PerfectHeader *) map;
+  if (!perfect || memcmp(header->magic, MAGIC, sizeof(header->magic)) ||
+      header->order != BYTE_ORDER_MARK) {
+    free(perfect);
+    munmap(map, st.st_size);
+    return NULL;
+  }
+
+  size_t offsets[4];
+  perfect->base = map;
+  perfect->bytes = st.st_size;
+  perfect->mapped = true;
+  if (layout(header, offsets) > perfect->bytes) {
+    AH1PerfectDestroy(perfect);
+    return NULL;
+  }
+
+  attach(perfect);
+  if (!parts_valid(perfect)) {
+    AH1PerfectDestroy(perfect);
+    return NULL;
+  }
+
+  return perfect;
+}
+
+int AH1PerfectSave(const AH1Perfect *perfect, const char *path)
+{
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1) return -1;
+
+  const char *p = perfect->base;
+  size_t left = perfect->bytes;
+  while (left) {
+    ssize_t n = write(fd, p, left);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) {
+      int saved = errno;
+      close(fd);
+      errno = saved;
+      return -1;
+    }
+    p += n;
+    left -= n;
+  }
+
+  return close(fd);
+}
+
+void AH1PerfectDestroy(AH1Perfect *perfect)
+{
+  if (!perfect) return;
+  if (perfect->mapped) munmap(perfect->base, perfect->bytes);
+  else free(perfect->base);
+  free(perfect);
+}
+
+size_t AH1PerfectKeys(const AH1Perfect *perfect)
+{
+  return perfect->header->keys;
+}
+
+size_t AH1PerfectBytes(const AH1Perfect *perfect)
+{
+  return perfect->bytes;
+}
+
+uint64_t AH1PerfectIndex(const AH1Perfect *perfect, const char *key, size_t size)
+{
+  uint64_t h1, h2;
+  key_hashes(key, size, &h1, &h2);
+
+  const AH1PerfectPart *part = &perfect->parts[partition_of(h1, perfect->header->partitions)];
+  if (!part->keys) return 0;
+
+  uint64_t pilot = pilot_of(perfect, part, bucket_of(part, h1));
+  uint32_t slot = slot_of(part, h2, pilot);
+  if (slot >= part->keys) slot = perfect->remapped[part->remapped + slot - part->keys];
+
+  return part->offset + slot;
+}
+
+#undef MAGIC
+#undef BYTE_ORDER_MARK
+#undef PARTITION_KEYS
+#undef BUCKET_C
+#undef ALPHA
+#undef DENSE_KEYS
+#undef DENSE_BUCKETS
+#undef ESCAPE
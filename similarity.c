@@ -0,0 +1,330 @@
+/* -- similarity.c
+ * MinHash and SimHash signatures over byte shingles, each shingle hashed
+ * once with AH2Hash, and an LSH banding index for finding near duplicates.
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2025 Abhigyan <nourr@duck.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "hash.h"
+
+#include <string.h>
+#include <stdbool.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define POPCOUNT64(n) ((unsigned int) __builtin_popcountll(n))
+#else
+static inline unsigned int POPCOUNT64(uint64_t n)
+{
+  unsigned int count = 0;
+  for (; n; n &= n - 1) count++;
+  return count;
+}
+#endif
+
+/* shingles hashed at a time before their bins are updated */
+#define GROUP_SIZE 16
+
+/* a bin no shingle fell into */
+#define EMPTY UINT64_MAX
+
+/* band keys live in fixed chunks, so the table can point at them */
+#define KEY_CHUNK 4096
+
+typedef struct AH2LshKey
+{
+  uint64_t band;
+  uint64_t hash;
+} AH2LshKey;
+
+typedef struct AH2LshPosting
+{
+  uint64_t doc;
+  uint64_t next;
+} AH2LshPosting;
+
+struct AH2Lsh
+{
+  unsigned int bands;
+  unsigned int rows;
+  AH1Table *table;
+  AH2LshKey **chunks;
+  size_t chunk_count;
+  size_t keys;
+  AH2LshPosting *postings;
+  size_t posting_count;
+  size_t posting_cap;
+};
+
+static inline uint64_t mix(uint64_t x)
+{
+  /* splitmix64 finalizer */
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+  return x ^ (x >> 31);
+}
+
+static inline size_t shingle_count(size_t size, unsigned int width)
+{
+  return size > width ? size - width + 1 : 1;
+}
+
+/* hashes the group of shingles starting at first into folded digests,
+ * returning the size of the group */
+static size_t hash_shingles(const char *text, size_t size, unsigned int width,
+                            size_t first, uint64_t folded[GROUP_SIZE][2])
+{
+  size_t left = shingle_count(size, width) - first;
+  size_t n = left < GROUP_SIZE ? left : GROUP_SIZE;
+  size_t bytes = size < width ? size : width;
+
+  for (size_t i = 0; i < n; ++i) {
+    uint64_t digest[4];
+    AH2Hash(text + first + i, bytes, digest);
+    AH2Fold(digest, folded[i]);
+  }
+  return n;
+}
+
+int AH2MinHash(const char *text, size_t size, unsigned int width,
+               uint64_t signature[], unsigned int k)
+{
+  for (unsigned int i = 0; i < k; ++i) signature[i] = EMPTY;
+  if (!size || !k) return 0;
+  if (!width) width = 1;
+
+  uint64_t folded[GROUP_SIZE][2];
+  size_t shingles = shingle_count(size, width);
+  for (size_t first = 0, n; first < shingles; first += n) {
+    n = hash_shingles(text, size, width, first, folded);
+
+    /* one folded word picks the bin, the other is kept as its minimum */
+    for (size_t i = 0; i < n; ++i) {
+      size_t bin = (size_t) (((folded[i][0] >> 32) * k) >> 32);
+      if (folded[i][1] < signature[bin]) signature[bin] = folded[i][1];
+    }
+  }
+
+  uint64_t *empty = calloc((k + 63) / 64, sizeof(uint64_t));
+  if (!empty) return -1;
+
+  for (unsigned int i = 0; i < k; ++i) {
+    if (signature[i] == EMPTY) empty[i >> 6] |= (uint64_t) 1 << (i & 63);
+  }
+
+  /* optimal densification: an empty bin probes bins in an order of its
+   * own until it finds one that was filled by a shingle */
+  for (unsigned int i = 0; i < k; ++i) {
+    if (!((empty[i >> 6] >> (i & 63)) & 1)) continue;
+
+    for (uint64_t attempt = 0;; ++attempt) {
+      unsigned int j = (unsigned int) (mix(((uint64_t) i << 32) | attempt) % k);
+      if (!((empty[j >> 6] >> (j & 63)) & 1)) {
+        signature[i] = signature[j];
+        break;
+      }
+    }
+  }
+
+  free(empty);
+  return 0;
+}
+
+double AH2MinHashSimilarity(const uint64_t a[], const uint64_t b[], unsigned int k)
+{
+  unsigned int same = 0;
+  for (unsigned int i = 0; i < k; ++i) same += a[i] == b[i];
+  return k ? (double) same / k : 0.0;
+}
+
+uint64_t AH2SimHash(const char *text, size_t size, unsigned int width)
+{
+  if (!size) return 0;
+  if (!width) width = 1;
+
+  uint64_t ones[64] = { 0 };
+  uint64_t folded[GROUP_SIZE][2];
+  size_t shingles = shingle_count(size, width);
+  for (size_t first = 0, n; first < shingles; first += n) {
+    n = hash_shingles(text, size, width, first, folded);
+
+    /* 32-bit lanes over 32-bit halves let the compiler vectorize the count */
+    uint32_t group[64] = { 0 };
+    for (size_t i = 0; i < n; ++i) {
+      uint64_t bits = folded[i][0];
+      uint32_t low = (uint32_t) bits, high = (uint32_t) (bits >> 32);
+      for (uint32_t b = 0; b < 32; ++b) {
+        group[b] += (low >> b) & 1;
+        group[b + 32] += (high >> b) & 1;
+      }
+    }
+
+    for (int b = 0; b < 64; ++b) ones[b] += group[b];
+  }
+
+  uint64_t simhash = 0;
+  for (int b = 0; b < 64; ++b) {
+    if (2 * ones[b] > shingles) simhash |= (uint64_t) 1 << b;
+  }
+
+  return simhash;
+}
+
+unsigned int AH2SimHashDistance(uint64_t a, uint64_t b)
+{
+  return POPCOUNT64(a ^ b);
+}
+
+AH2Lsh *AH2LshCreate(unsigned int bands, unsigned int rows)
+{
+  if (!bands || !rows) return NULL;
+
+  AH2Lsh *lsh = calloc(1, sizeof(AH2Lsh));
+  if (!lsh) return NULL;
+
+  lsh->bands = bands;
+  lsh->rows = rows;
+  lsh->table = AH1TableCreate(0);
+  if (!lsh->table) {
+    free(lsh);
+    return NULL;
+  }
+
+  return lsh;
+}
+
+void AH2LshDestroy(AH2Lsh *lsh)
+{
+  if (!lsh) return;
+
+  AH1TableDestroy(lsh->table);
+  for (size_t i = 0; i < lsh->chunk_count; ++i) free(lsh->chunks[i]);
+  free(lsh->chunks);
+  free(lsh->postings);
+  free(lsh);
+}
+
+static inline AH2LshKey band_key(const AH2Lsh *lsh, const uint64_t signature[],
+                                 unsigned int band)
+{
+  uint32_t hash[4];
+  AH1Hash((const char *) (signature + (size_t) band * lsh->rows),
+          lsh->rows * sizeof(uint64_t), hash);
+
+  AH2LshKey key = { band, ((uint64_t) hash[0] << 32) | hash[1] };
+  return key;
+}
+
+/* copies a key into the chunks, where it stays put for the table */
+static AH2LshKey *keep_key(AH2Lsh *lsh, AH2LshKey key)
+{
+  if (lsh->keys == lsh->chunk_count * KEY_CHUNK) {
+    AH2LshKey **chunks = realloc(lsh->chunks, (lsh->chunk_count + 1) * sizeof(AH2LshKey *));
+    if (!chunks) return NULL;
+    lsh->chunks = chunks;
+
+    lsh->chunks[lsh->chunk_count] = malloc(KEY_CHUNK * sizeof(AH2LshKey));
+    if (!lsh->chunks[lsh->chunk_count]) return NULL;
+    lsh->chunk_count++;
+  }
+
+  AH2LshKey *kept = &lsh->chunks[lsh->keys / KEY_CHUNK][lsh->keys % KEY_CHUNK];
+  *kept = key;
+  lsh->keys++;
+  return kept;
+}
+
+int AH2LshInsert(AH2Lsh *lsh, const uint64_t signature[], uint64_t doc)
+{
+  if (lsh->posting_count + lsh->bands > lsh->posting_cap) {
+    size_t cap = lsh->posting_cap ? 2 * lsh->posting_cap : 1024;
+    while (cap < lsh->posting_count + lsh->bands) cap *= 2;
+
+    AH2LshPosting *postings = realloc(lsh->postings, cap * sizeof(AH2LshPosting));
+    if (!postings) return -1;
+    lsh->postings = postings;
+    lsh->posting_cap = cap;
+  }
+
+  for (unsigned int band = 0; band < lsh->bands; ++band) {
+    AH2LshKey key = band_key(lsh, signature, band);
+
+    /* cells hold one past the index of the band's latest posting */
+    uint64_t *cell = AH1TableFind(lsh->table, (const char *) &key, sizeof(key));
+    if (!cell) {
+      AH2LshKey *kept = keep_key(lsh, key);
+      if (!kept) return -1;
+      cell = AH1TableUpsert(lsh->table, (const char *) kept, sizeof(key));
+      if (!cell) return -1;
+    }
+
+    AH2LshPosting *posting = &lsh->postings[lsh->posting_count];
+    posting->doc = doc;
+    posting->next = *cell;
+    *cell = ++lsh->posting_count;
+  }
+
+  return 0;
+}
+
+static int by_doc(const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+  return (x > y) - (x < y);
+}
+
+static size_t unique(uint64_t docs[], size_t count)
+{
+  if (!count) return 0;
+  qsort(docs, count, sizeof(uint64_t), by_doc);
+
+  size_t kept = 1;
+  for (size_t i = 1; i < count; ++i) {
+    if (docs[i] != docs[kept - 1]) docs[kept++] = docs[i];
+  }
+
+  return kept;
+}
+
+size_t AH2LshQuery(const AH2Lsh *lsh, const uint64_t signature[],
+                   uint64_t candidates[], size_t max)
+{
+  size_t found = 0;
+  for (unsigned int band = 0; band < lsh->bands; ++band) {
+    AH2LshKey key = band_key(lsh, signature, band);
+    uint64_t *cell = AH1TableFind(lsh->table, (const char *) &key, sizeof(key));
+
+    for (uint64_t at = cell ? *cell : 0; at; at = lsh->postings[at - 1].next) {
+      if (found == max) {
+        /* make room by dropping repeats; stop once they are all distinct */
+        found = unique(candidates, found);
+        if (found == max) return found;
+      }
+      candidates[found++] = lsh->postings[at - 1].doc;
+    }
+  }
+
+  return unique(candidates, found);
+}
+
+#undef POPCOUNT64
+#undef GROUP_SIZE
+#undef EMPTY
+#undef KEY_CHUNK
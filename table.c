@@ -0,0 +1,300 @@
+/* -- table.c
+ * Open-addressing hash table keyed by AH1Hash, with bulk operations that
+ * overlap hashing with bucket fetches through group prefetching.
+ * 
+ * MIT License
+ * 
+ * Copyright (c) 2025 Abhigyan <nourr@duck.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "hash.h"
+
+#include <string.h>
+#include <stdbool.h>
+#include <sys/mman.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PREFETCH(p) __builtin_prefetch((p), 0, 3)
+#else
+#define PREFETCH(p) ((void) (p))
+#endif
+
+/* number of keys hashed and prefetched before the first of them is probed */
+#define GROUP_SIZE 16
+
+/* slots scanned for a matching tag once a bucket has been prefetched */
+#define SCAN_SLOTS 4
+
+/* smallest power of two number of slots a table is allocated with */
+#define MIN_SLOTS 16
+
+/* most slots a table can have, the largest power of two whose bytes fit */
+#define MAX_SLOTS ((SIZE_MAX / 2 + 1) / sizeof(AH1Slot))
+
+/* tables at least this large are mapped directly and backed by huge pages */
+#define HUGE_PAGE ((size_t) 1 << 21)
+
+/* an empty slot has a zero tag; stored tags always have the low bit set */
+typedef struct AH1Slot
+{
+  uint64_t tag;
+  const char *key;
+  size_t size;
+  uint64_t value;
+} AH1Slot;
+
+struct AH1Table
+{
+  AH1Slot *slots;
+  size_t mask;
+  unsigned int shift;
+  size_t count;
+  size_t limit;
+};
+
+static inline uint64_t key_tag(const char *key, size_t size)
+{
+  uint32_t hash[4];
+  AH1Hash(key, size, hash);
+  return ((uint64_t) hash[0] << 32) | hash[1] | 1;
+}
+
+/* the bucket comes from the top bits, leaving the forced low bit alone */
+static inline size_t tag_bucket(const AH1Table *table, uint64_t tag)
+{
+  return (size_t) (tag >> table->shift);
+}
+
+/* returns the slot holding the key, or the empty slot it belongs in */
+static inline AH1Slot *probe(const AH1Table *table, uint64_t tag,
+                             const char *key, size_t size)
+{
+  size_t i = tag_bucket(table, tag);
+  for (;;) {
+    AH1Slot *slot = &table->slots[i];
+    if (!slot->tag) return slot;
+    if (slot->tag == tag && slot->size == size && !memcmp(slot->key, key, size))
+      return slot;
+
+    i = (i + 1) & table->mask;
+  }
+}
+
+static inline uint64_t *claim(AH1Table *table, AH1Slot *slot, uint64_t tag,
+                              const char *key, size_t size)
+{
+  if (!slot->tag) {
+    slot->tag = tag;
+    slot->key = key;
+    slot->size = size;
+    slot->value = 0;
+    table->count++;
+  }
+
+  return &slot->value;
+}
+
+static int table_alloc(AH1Table *table, size_t slots)
+{
+  if (!slots || slots > MAX_SLOTS) return -1;
+
+  unsigned int bits = 0;
+  while (((size_t) 1 << bits) < slots) bits++;
+  slots = (size_t) 1 << bits;
+
+  size_t bytes = slots * sizeof(AH1Slot);
+  if (bytes < HUGE_PAGE) {
+    table->slots = calloc(slots, sizeof(AH1Slot));
+    if (!table->slots) return -1;
+  } else {
+    /* zero pages are mapped lazily; asking for huge pages keeps probes of a
+     * large table from missing the TLB as well as the cache */
+    void *memory = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) return -1;
+#ifdef MADV_HUGEPAGE
+    madvise(memory, bytes, MADV_HUGEPAGE);
+#endif
+    table->slots = memory;
+  }
+
+  table->mask = slots - 1;
+  table->shift = 64 - bits;
+  /* keep linear probe chains short enough to end in the prefetched line */
+  table->limit = slots / 2;
+  return 0;
+}
+
+static void slots_free(AH1Slot *slots, size_t mask)
+{
+  size_t bytes = (mask + 1) * sizeof(AH1Slot);
+  if (bytes < HUGE_PAGE) free(slots);
+  else munmap(slots, bytes);
+}
+
+/* smallest slot count that keeps keys under the load limit, 0 if no
+ * table that large can be addressed */
+static size_t slots_for(size_t keys)
+{
+  if (keys > MAX_SLOTS / 2) return 0;
+
+  size_t slots = MIN_SLOTS;
+  while (slots / 2 < keys) slots *= 2;
+  return slots;
+}
+
+AH1Table *AH1TableCreate(size_t capacity)
+{
+  AH1Table *table = malloc(sizeof(AH1Table));
+  if (!table) return NULL;
+
+  table->count = 0;
+  if (table_alloc(table, slots_for(capacity))) {
+    free(table);
+    return NULL;
+  }
+
+  return table;
+}
+
+void AH1TableDestroy(AH1Table *table)
+{
+  if (!table) return;
+  slots_free(table->slots, table->mask);
+  free(table);
+}
+
+size_t AH1TableSize(const AH1Table *table)
+{
+  return table->count;
+}
+
+int AH1TableReserve(AH1Table *table, size_t count)
+{
+  if (count > SIZE_MAX - table->count) return -1;
+  if (table->count + count <= table->limit) return 0;
+
+  AH1Table grown = *table;
+  if (table_alloc(&grown, slots_for(table->count + count))) return -1;
+
+  /* stored tags already carry the hash, so no key is hashed again */
+  for (size_t i = 0; i <= table->mask; ++i) {
+    const AH1Slot *old = &table->slots[i];
+    if (!old->tag) continue;
+
+    size_t j = tag_bucket(&grown, old->tag);
+    while (grown.slots[j].tag) j = (j + 1) & grown.mask;
+    grown.slots[j] = *old;
+  }
+
+  slots_free(table->slots, table->mask);
+  *table = grown;
+  return 0;
+}
+
+uint64_t *AH1TableUpsert(AH1Table *table, const char *key, size_t size)
+{
+  if (AH1TableReserve(table, 1)) return NULL;
+
+  uint64_t tag = key_tag(key, size);
+  return claim(table, probe(table, tag, key, size), tag, key, size);
+}
+
+uint64_t *AH1TableFind(const AH1Table *table, const char *key, size_t size)
+{
+  AH1Slot *slot = probe(table, key_tag(key, size), key, size);
+  return slot->tag ? &slot->value : NULL;
+}
+
+/*
+ * Second stage of the bulk pipeline. The buckets prefetched by the first
+ * stage have had a whole group's hashing to arrive, so their tags can be
+ * read. A matching tag means the slot's out-of-line key is compared next,
+ * and it is prefetched too so that the comparison does not miss again.
+ */
+static inline void prefetch_keys(const AH1Table *table, const uint64_t tags[],
+                                 size_t n)
+{
+  for (size_t i = 0; i < n; ++i) {
+    size_t j = tag_bucket(table, tags[i]);
+    for (int k = 0; k < SCAN_SLOTS; ++k) {
+      const AH1Slot *slot = &table->slots[j];
+      if (!slot->tag) break;
+      if (slot->tag == tags[i]) {
+        PREFETCH(slot->key);
+        break;
+      }
+      j = (j + 1) & table->mask;
+    }
+  }
+}
+
+int AH1TableUpsertBulk(AH1Table *table, const char *const keys[],
+                       const size_t sizes[], size_t count, uint64_t *cells[])
+{
+  if (AH1TableReserve(table, count)) return -1;
+
+  uint64_t tags[GROUP_SIZE];
+  for (size_t base = 0; base < count; base += GROUP_SIZE) {
+    size_t n = count - base < GROUP_SIZE ? count - base : GROUP_SIZE;
+
+    for (size_t i = 0; i < n; ++i) {
+      tags[i] = key_tag(keys[base + i], sizes[base + i]);
+      PREFETCH(&table->slots[tag_bucket(table, tags[i])]);
+    }
+    prefetch_keys(table, tags, n);
+
+    /* keys repeated within a group resolve in order, so they share a cell */
+    for (size_t i = 0; i < n; ++i) {
+      const char *key = keys[base + i];
+      size_t size = sizes[base + i];
+      AH1Slot *slot = probe(table, tags[i], key, size);
+      cells[base + i] = claim(table, slot, tags[i], key, size);
+    }
+  }
+
+  return 0;
+}
+
+void AH1TableFindBulk(const AH1Table *table, const char *const keys[],
+                      const size_t sizes[], size_t count, uint64_t *cells[])
+{
+  uint64_t tags[GROUP_SIZE];
+  for (size_t base = 0; base < count; base += GROUP_SIZE) {
+    size_t n = count - base < GROUP_SIZE ? count - base : GROUP_SIZE;
+
+    for (size_t i = 0; i < n; ++i) {
+      tags[i] = key_tag(keys[base + i], sizes[base + i]);
+      PREFETCH(&table->slots[tag_bucket(table, tags[i])]);
+    }
+    prefetch_keys(table, tags, n);
+
+    for (size_t i = 0; i < n; ++i) {
+      AH1Slot *slot = probe(table, tags[i], keys[base + i], sizes[base + i]);
+      cells[base + i] = slot->tag ? &slot->value : NULL;
+    }
+  }
+}
+
+#undef PREFETCH
+#undef GROUP_SIZE
+#undef SCAN_SLOTS
+#undef MIN_SLOTS
+#undef MAX_SLOTS
+#undef HUGE_PAGE
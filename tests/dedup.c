@@ -0,0 +1,512 @@
+/* -- dedup.c
+ * Removes duplicate lines from inputs larger than memory by spilling them
+ * into partitions by AH2 digest and deduplicating the partitions in parallel.
+ *
+ * MIT License
+ * 
+ * Copyright (c) 2025 Abhigyan <nourr@duck.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <AH1.h>
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define EXIT_SUCCESS 0
+#define EXIT_FAILURE 1
+
+/* size of the blocks input is read in */
+#define READ_SIZE (1 << 20)
+
+/* size of each thread's output buffer */
+#define WRITE_SIZE (1 << 20)
+
+/* largest and smallest write buffer kept for one spill file */
+#define SPILL_BUFF_SIZE (1 << 16)
+#define SPILL_BUFF_MIN  (1 << 12)
+
+/* bits of the fingerprint used when an oversized partition is split again */
+#define SPLIT_BITS 4
+
+/* bytes of an AH1Table slot and the fewest slots a table is created with */
+#define SLOT_SIZE 32
+#define TABLE_SLOTS 16
+
+/* records hashed and looked up together */
+#define BATCH 256
+
+/* a spill record is a fingerprint, a length and the line without newline */
+typedef struct Record
+{
+  uint64_t fp[2];
+  uint64_t size;
+  const char *line;
+} Record;
+
+typedef struct Spill
+{
+  int fd;
+  char *buff;
+  size_t used;
+  size_t bytes;
+  size_t records;
+} Spill;
+
+typedef struct Output
+{
+  char *buff;
+  size_t used;
+} Output;
+
+typedef struct Options
+{
+  size_t memory;
+  size_t partitions;
+  int threads;
+  int exact;
+  const char *tmpdir;
+} Options;
+
+static Options opts;
+static size_t spill_buff_size;
+static Spill *spills;
+static atomic_size_t next_partition;
+static pthread_mutex_t output_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void die(const char *message)
+{
+  perror(message);
+  exit(EXIT_FAILURE);
+}
+
+void write_all(int fd, const char *bytes, size_t size)
+{
+  while (size) {
+    ssize_t n = write(fd, bytes, size);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      die("file i/o: cannot write.");
+    }
+    bytes += n;
+    size -= n;
+  }
+}
+
+/* fingerprint of a line, folded from all four digest words */
+void fingerprint(const char *line, size_t size, uint64_t fp[2])
+{
+  uint64_t digest[4];
+  AH2Hash(line, size, digest);
+  AH2Fold(digest, fp);
+}
+
+/* the first pass partition of a fingerprint, for any number of partitions */
+static inline size_t partition_of(const uint64_t fp[2])
+{
+  return (size_t) (((fp[0] >> 32) * opts.partitions) >> 32);
+}
+
+/* the part of a split a fingerprint falls in, from its second word's bits
+ * after offset, which the first pass partition does not depend on */
+static inline size_t split_of(const uint64_t fp[2], unsigned int offset)
+{
+  return (size_t) ((fp[1] << offset) >> (64 - SPLIT_BITS));
+}
+
+void spill_open(Spill *spill)
+{
+  char path[4096];
+  snprintf(path, sizeof(path), "%s/ah1dedup.XXXXXX", opts.tmpdir);
+  spill->fd = mkstemp(path);
+  if (spill->fd == -1) die("file i/o: cannot create spill file.");
+  /* the file lives on only as long as the descriptor does */
+  unlink(path);
+
+  spill->buff = malloc(spill_buff_size);
+  if (!spill->buff) die("Unable to allocate spill buffer.");
+  spill->used = 0;
+  spill->bytes = 0;
+  spill->records = 0;
+}
+
+void spill_flush(Spill *spill)
+{
+  write_all(spill->fd, spill->buff, spill->used);
+  spill->bytes += spill->used;
+  spill->used = 0;
+}
+
+void spill_close(Spill *spill)
+{
+  free(spill->buff);
+  close(spill->fd);
+}
+
+void spill_put(Spill *spill, const uint64_t fp[2], const char *line, uint64_t size)
+{
+  char head[sizeof(uint64_t) * 3];
+  memcpy(head, fp, sizeof(uint64_t) * 2);
+  memcpy(head + sizeof(uint64_t) * 2, &size, sizeof(uint64_t));
+
+  if (spill->used + sizeof(head) + size > spill_buff_size) spill_flush(spill);
+  if (sizeof(head) + size > spill_buff_size) {
+    /* lines longer than the buffer go straight to the file */
+    write_all(spill->fd, head, sizeof(head));
+    write_all(spill->fd, line, size);
+    spill->bytes += sizeof(head) + size;
+  } else {
+    memcpy(spill->buff + spill->used, head, sizeof(head));
+    memcpy(spill->buff + spill->used + sizeof(head), line, size);
+    spill->used += sizeof(head) + size;
+  }
+
+  spill->records++;
+}
+
+/* reads the record at p, returning a pointer past it */
+static inline const char *record_get(const char *p, Record *record)
+{
+  memcpy(record->fp, p, sizeof(uint64_t) * 2);
+  memcpy(&record->size, p + sizeof(uint64_t) * 2, sizeof(uint64_t));
+  record->line = p + sizeof(uint64_t) * 3;
+  return record->line + record->size;
+}
+
+void output_flush(Output *out)
+{
+  pthread_mutex_lock(&output_lock);
+  write_all(STDOUT_FILENO, out->buff, out->used);
+  pthread_mutex_unlock(&output_lock);
+  out->used = 0;
+}
+
+void output_line(Output *out, const char *line, size_t size)
+{
+  if (out->used + size + 1 > WRITE_SIZE) output_flush(out);
+  if (size + 1 > WRITE_SIZE) {
+    pthread_mutex_lock(&output_lock);
+    write_all(STDOUT_FILENO, line, size);
+    write_all(STDOUT_FILENO, "\n", 1);
+    pthread_mutex_unlock(&output_lock);
+    return;
+  }
+
+  memcpy(out->buff + out->used, line, size);
+  out->buff[out->used + size] = '\n';
+  out->used += size + 1;
+}
+
+/* bytes of the table AH1TableCreate allocates for a number of keys: it
+ * rounds slots up to a power of two and fills at most half of them */
+static size_t table_bytes(size_t keys)
+{
+  size_t slots = TABLE_SLOTS;
+  while (slots / 2 < keys) {
+    if (slots > SIZE_MAX / 2 / SLOT_SIZE) return SIZE_MAX;
+    slots *= 2;
+  }
+  return slots * SLOT_SIZE;
+}
+
+/* writes every first occurrence in a mapped spill file to the output */
+void dedup_records(const char *p, size_t records, Output *out)
+{
+  AH1Table *table = AH1TableCreate(records);
+  if (!table) die("Unable to allocate partition table.");
+
+  Record batch[BATCH];
+  const char *keys[BATCH];
+  size_t sizes[BATCH];
+  uint64_t *cells[BATCH];
+
+  while (records) {
+    size_t n = records < BATCH ? records : BATCH;
+    for (size_t i = 0; i < n; ++i) {
+      const char *fp = p;
+      p = record_get(p, &batch[i]);
+      /* records point into the mapping, so keys need no copying */
+      keys[i] = opts.exact ? batch[i].line : fp;
+      sizes[i] = opts.exact ? batch[i].size : sizeof(uint64_t) * 2;
+    }
+
+    if (AH1TableUpsertBulk(table, keys, sizes, n, cells))
+      die("Unable to grow partition table.");
+
+    for (size_t i = 0; i < n; ++i) {
+      if (*cells[i]) continue;
+      *cells[i] = 1;
+      output_line(out, batch[i].line, batch[i].size);
+    }
+
+    records -= n;
+  }
+
+  AH1TableDestroy(table);
+}
+
+/*
+ * Splits the records of a mapped spill file on the next fingerprint bits.
+ * Lines already seen in this pass are dropped on the way, as far as the
+ * memory budget allows, so that a part holding many copies of a few lines
+ * shrinks instead of being rewritten at every level.
+ */
+void split_records(const char *p, size_t records, unsigned int offset,
+                   Spill parts[])
+{
+  /* half the thread's budget, less the parts' buffers, bounds the table */
+  size_t budget = opts.memory / opts.threads / 2;
+  size_t buffers = ((size_t) 1 << SPLIT_BITS) * spill_buff_size;
+  budget = budget > buffers ? budget - buffers : 0;
+
+  size_t slots = TABLE_SLOTS;
+  while (slots <= budget / 2 / SLOT_SIZE) slots *= 2;
+  size_t limit = slots * SLOT_SIZE <= budget ? slots / 2 : 0;
+  if (limit > records) limit = records;
+
+  AH1Table *seen = AH1TableCreate(limit);
+  if (!seen) die("Unable to allocate partition table.");
+
+  for (size_t i = 0; i < records; ++i) {
+    Record record;
+    const char *fp = p;
+    p = record_get(p, &record);
+    const char *key = opts.exact ? record.line : fp;
+    size_t size = opts.exact ? record.size : sizeof(uint64_t) * 2;
+
+    if (AH1TableSize(seen) < limit) {
+      uint64_t *cell = AH1TableUpsert(seen, key, size);
+      if (!cell) die("Unable to grow partition table.");
+      if ((*cell)++) continue;
+    } else if (AH1TableFind(seen, key, size)) {
+      continue;
+    }
+
+    spill_put(&parts[split_of(record.fp, offset)], record.fp, record.line,
+              record.size);
+  }
+
+  AH1TableDestroy(seen);
+}
+
+/* deduplicates a spill file, splitting it while it exceeds the budget;
+ * the spill is closed before its parts are, so files never pile up */
+void dedup_spill(Spill *spill, unsigned int offset, Output *out)
+{
+  if (spill->used) spill_flush(spill);
+  if (!spill->records) {
+    spill_close(spill);
+    return;
+  }
+
+  char *map = mmap(NULL, spill->bytes, PROT_READ, MAP_PRIVATE, spill->fd, 0);
+  if (map == MAP_FAILED) die("file i/o: unable to map spill file.");
+  madvise(map, spill->bytes, MADV_SEQUENTIAL);
+
+  size_t table = table_bytes(spill->records);
+  size_t budget = opts.memory / opts.threads;
+  int fits = table <= budget && spill->bytes <= budget - table;
+  if (fits || offset + SPLIT_BITS > 64) {
+    dedup_records(map, spill->records, out);
+    munmap(map, spill->bytes);
+    spill_close(spill);
+    return;
+  }
+
+  /* too big to hold at once: split on the next fingerprint bits */
+  Spill parts[1 << SPLIT_BITS];
+  for (int i = 0; i < 1 << SPLIT_BITS; ++i) spill_open(&parts[i]);
+  split_records(map, spill->records, offset, parts);
+
+  size_t records = spill->records;
+  munmap(map, spill->bytes);
+  spill_close(spill);
+
+  for (int i = 0; i < 1 << SPLIT_BITS; ++i) {
+    /* a part that kept every record holds distinct lines sharing these bits,
+     * and splitting it again would only rewrite it */
+    unsigned int next = parts[i].records == records ? 64 : offset + SPLIT_BITS;
+    dedup_spill(&parts[i], next, out);
+  }
+}
+
+void *dedup_worker(void *arg)
+{
+  Output out = { malloc(WRITE_SIZE), 0 };
+  if (!out.buff) die("Unable to allocate output buffer.");
+
+  for (;;) {
+    size_t i = atomic_fetch_add(&next_partition, 1);
+    if (i >= opts.partitions) break;
+
+    dedup_spill(&spills[i], 0, &out);
+  }
+
+  output_flush(&out);
+  free(out.buff);
+  return NULL;
+}
+
+/* one sequential pass over the input, spilling every line by digest */
+void partition_input(int fd)
+{
+  size_t cap = 2 * READ_SIZE;
+  char *buff = malloc(cap);
+  if (!buff) die("Unable to allocate read buffer.");
+
+  size_t used = 0;
+  for (;;) {
+    if (cap - used < READ_SIZE) {
+      /* a line longer than the buffer keeps growing it */
+      cap *= 2;
+      buff = realloc(buff, cap);
+      if (!buff) die("Unable to grow read buffer.");
+    }
+
+    ssize_t n = read(fd, buff + used, cap - used);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      die("file i/o: cannot read input.");
+    }
+
+    size_t end = used + n;
+    char *line = buff;
+    char *newline;
+    while ((newline = memchr(line, '\n', buff + end - line))) {
+      uint64_t fp[2];
+      size_t size = newline - line;
+      fingerprint(line, size, fp);
+      spill_put(&spills[partition_of(fp)], fp, line, size);
+      line = newline + 1;
+    }
+
+    used = buff + end - line;
+    memmove(buff, line, used);
+
+    if (!n) {
+      /* the last line may lack its newline */
+      if (used) {
+        uint64_t fp[2];
+        fingerprint(buff, used, fp);
+        spill_put(&spills[partition_of(fp)], fp, buff, used);
+      }
+      break;
+    }
+  }
+
+  free(buff);
+}
+
+size_t parse_size(const char *arg)
+{
+  char *end;
+  size_t size = strtoull(arg, &end, 10);
+  switch (*end) {
+  case 'G': case 'g': size <<= 10; /* fall through */
+  case 'M': case 'm': size <<= 10; /* fall through */
+  case 'K': case 'k': size <<= 10; break;
+  case '\0': size <<= 20; break;
+  default: size = 0;
+  }
+
+  return size;
+}
+
+void usage(void)
+{
+  printf("Usage: ah1dedup [-x] [-m MEMORY] [-j THREADS] [-p PARTITIONS] "
+         "[-t TMPDIR] [FILE]\n"
+         "  -x  compare lines byte for byte instead of by 128-bit fingerprint\n"
+         "  -m  memory budget, in megabytes or with a K, M or G suffix (1024M)\n"
+         "  -j  threads deduplicating partitions (online processors)\n"
+         "  -p  number of partitions spilled in the first pass (256), at most\n"
+         "      one per 16K of the memory budget\n"
+         "  -t  directory for spill files ($TMPDIR or /tmp)\n"
+         "Lines are written once each, in no particular order.\n");
+}
+
+int main(int argc, char **argv)
+{
+  opts.memory = (size_t) 1 << 30;
+  opts.partitions = 256;
+  opts.threads = sysconf(_SC_NPROCESSORS_ONLN);
+  opts.tmpdir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+
+  int c;
+  while ((c = getopt(argc, argv, "xm:j:p:t:h")) != -1) {
+    switch (c) {
+    case 'x': opts.exact = 1; break;
+    case 'm': opts.memory = parse_size(optarg); break;
+    case 'j': opts.threads = atoi(optarg); break;
+    case 'p': opts.partitions = strtoull(optarg, NULL, 10); break;
+    case 't': opts.tmpdir = optarg; break;
+    default: usage(); return EXIT_FAILURE;
+    }
+  }
+
+  if (!opts.memory || opts.threads < 1 || !opts.partitions
+      || opts.partitions > UINT32_MAX) {
+    usage();
+    return EXIT_FAILURE;
+  }
+
+  int fd = STDIN_FILENO;
+  if (optind < argc) {
+    fd = open(argv[optind], O_RDONLY);
+    if (fd == -1) die("file i/o: cannot open file.");
+  }
+
+  /* spill buffers take at most a quarter of the budget, so a budget too
+   * small for every partition's smallest buffer gets fewer partitions */
+  size_t most = opts.memory / 4 / SPILL_BUFF_MIN;
+  if (opts.partitions > most) opts.partitions = most ? most : 1;
+
+  spill_buff_size = opts.memory / 4 / opts.partitions;
+  if (spill_buff_size > SPILL_BUFF_SIZE) spill_buff_size = SPILL_BUFF_SIZE;
+  if (spill_buff_size < SPILL_BUFF_MIN) spill_buff_size = SPILL_BUFF_MIN;
+
+  spills = malloc(opts.partitions * sizeof(Spill));
+  if (!spills) die("Unable to allocate partitions.");
+  for (size_t i = 0; i < opts.partitions; ++i) spill_open(&spills[i]);
+
+  partition_input(fd);
+  if (fd != STDIN_FILENO) close(fd);
+
+  pthread_t *threads = malloc(opts.threads * sizeof(pthread_t));
+  if (!threads) die("Unable to allocate threads.");
+  for (int t = 0; t < opts.threads; ++t) {
+    if (pthread_create(&threads[t], NULL, dedup_worker, NULL))
+      die("Unable to start worker thread.");
+  }
+  for (int t = 0; t < opts.threads; ++t) pthread_join(threads[t], NULL);
+
+  free(threads);
+  free(spills);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,396 @@
+/* -- dupes.c
+ * Finds duplicate files by narrowing candidates down by size, then by an
+ * AH1 fingerprint of sampled blocks, and only then by a full AH2 digest.
+ *
+ * MIT License
+ * 
+ * Copyright (c) 2025 Abhigyan <nourr@duck.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <AH1.h>
+
+#include <ftw.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <setjmp.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define EXIT_SUCCESS 0
+#define EXIT_FAILURE 1
+
+/* size of each sampled block */
+#define BLOCK 4096
+
+/* blocks sampled between the head and the tail of a file */
+#define STRIDES 6
+
+/* files no larger than this are fingerprinted whole */
+#define SAMPLE_SIZE ((STRIDES + 2) * BLOCK)
+
+/* most directories nftw keeps open at once */
+#define MAX_FDS 64
+
+typedef struct File
+{
+  char *path;
+  off_t size;
+  dev_t dev;
+  ino_t ino;
+  uint32_t sample[4];
+  uint64_t digest[4];
+  int failed;
+} File;
+
+static File *files;
+static size_t file_count, file_cap;
+static off_t min_size = 1;
+
+static File **work;
+static size_t work_count;
+static atomic_size_t work_next;
+static void (*stage)(File *file);
+
+/* where a worker resumes when a file it hashes is truncated under it */
+static _Thread_local sigjmp_buf bus_jump;
+static _Thread_local volatile sig_atomic_t bus_armed;
+
+void die(const char *message)
+{
+  perror(message);
+  exit(EXIT_FAILURE);
+}
+
+void warn(const char *path)
+{
+  fprintf(stderr, "ah1dupes: %s: %s\n", path, strerror(errno));
+}
+
+int collect(const char *path, const struct stat *st, int type, struct FTW *ftw)
+{
+  if (type == FTW_DNR || type == FTW_NS) {
+    warn(path);
+    return 0;
+  }
+
+  if (type != FTW_F || !S_ISREG(st->st_mode) || st->st_size < min_size)
+    return 0;
+
+  if (file_count == file_cap) {
+    file_cap = file_cap ? 2 * file_cap : 1024;
+    files = realloc(files, file_cap * sizeof(File));
+    if (!files) die("Unable to allocate file list.");
+  }
+
+  File *file = &files[file_count++];
+  memset(file, 0, sizeof(File));
+  file->path = strdup(path);
+  if (!file->path) die("Unable to allocate file path.");
+  file->size = st->st_size;
+  file->dev = st->st_dev;
+  file->ino = st->st_ino;
+  return 0;
+}
+
+/* a fault outside a guarded hash is left to kill the process as before */
+void on_bus(int sig)
+{
+  if (bus_armed) siglongjmp(bus_jump, 1);
+  signal(sig, SIG_DFL);
+}
+
+int read_at(int fd, char *buff, size_t size, off_t offset)
+{
+  while (size) {
+    ssize_t n = pread(fd, buff, size, offset);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return -1;
+    buff += n;
+    size -= n;
+    offset += n;
+  }
+
+  return 0;
+}
+
+/* AH1Hash over the head, the tail and evenly strided blocks in between */
+void sample_file(File *file)
+{
+  char buff[SAMPLE_SIZE];
+  int fd = open(file->path, O_RDONLY);
+  if (fd == -1) {
+    warn(file->path);
+    file->failed = 1;
+    return;
+  }
+
+  size_t size = SAMPLE_SIZE;
+  int err;
+  if (file->size <= SAMPLE_SIZE) {
+    size = file->size;
+    err = read_at(fd, buff, size, 0);
+  } else {
+    off_t last = file->size - BLOCK;
+    err = read_at(fd, buff, BLOCK, 0);
+    for (int i = 1; i <= STRIDES && !err; ++i) {
+      off_t offset = last / (STRIDES + 1) * i / BLOCK * BLOCK;
+      err = read_at(fd, buff + i * BLOCK, BLOCK, offset);
+    }
+    if (!err) err = read_at(fd, buff + (STRIDES + 1) * BLOCK, BLOCK, last);
+  }
+
+  if (err) {
+    warn(file->path);
+    file->failed = 1;
+  } else {
+    AH1Hash(buff, size, file->sample);
+  }
+
+  close(fd);
+}
+
+void digest_file(File *file)
+{
+  int fd = open(file->path, O_RDONLY);
+  if (fd == -1) {
+    warn(file->path);
+    file->failed = 1;
+    return;
+  }
+
+  /* mapping past the end of a file that shrank since it was listed would
+   * fault, so a file that changed is dropped instead */
+  struct stat st;
+  if (fstat(fd, &st) == -1 || st.st_size != file->size
+      || st.st_dev != file->dev || st.st_ino != file->ino) {
+    fprintf(stderr, "ah1dupes: %s: changed while being read\n", file->path);
+    file->failed = 1;
+    close(fd);
+    return;
+  }
+
+  char *map = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED) {
+    warn(file->path);
+    file->failed = 1;
+    close(fd);
+    return;
+  }
+
+  /* a file can still shrink while it is hashed, and reading the mapping
+   * past its new end raises SIGBUS, which lands back here */
+  posix_madvise(map, file->size, POSIX_MADV_SEQUENTIAL);
+  if (!sigsetjmp(bus_jump, 1)) {
+    bus_armed = 1;
+    AH2Hash(map, file->size, file->digest);
+  } else {
+    fprintf(stderr, "ah1dupes: %s: changed while being read\n", file->path);
+    file->failed = 1;
+  }
+  bus_armed = 0;
+
+  munmap(map, file->size);
+  close(fd);
+}
+
+void *stage_worker(void *arg)
+{
+  for (;;) {
+    size_t i = atomic_fetch_add(&work_next, 1);
+    if (i >= work_count) break;
+    stage(work[i]);
+  }
+
+  return NULL;
+}
+
+/* runs a stage over the candidates, with at most jobs files open at once */
+void run_stage(void (*fn)(File *file), File **candidates, size_t count, int jobs)
+{
+  stage = fn;
+  work = candidates;
+  work_count = count;
+  atomic_store(&work_next, 0);
+
+  if ((size_t) jobs > count) jobs = count;
+  pthread_t *threads = malloc(jobs * sizeof(pthread_t));
+  if (jobs && !threads) die("Unable to allocate threads.");
+
+  for (int t = 0; t < jobs; ++t) {
+    if (pthread_create(&threads[t], NULL, stage_worker, NULL))
+      die("Unable to start worker thread.");
+  }
+  for (int t = 0; t < jobs; ++t) pthread_join(threads[t], NULL);
+
+  free(threads);
+}
+
+/* same file first, then in the order files were listed */
+int by_inode(const void *a, const void *b)
+{
+  const File *x = *(File *const *) a, *y = *(File *const *) b;
+  if (x->dev != y->dev) return (x->dev > y->dev) - (x->dev < y->dev);
+  if (x->ino != y->ino) return (x->ino > y->ino) - (x->ino < y->ino);
+  return (x > y) - (x < y);
+}
+
+int by_size(const void *a, const void *b)
+{
+  const File *x = *(File *const *) a, *y = *(File *const *) b;
+  return (x->size > y->size) - (x->size < y->size);
+}
+
+int by_sample(const void *a, const void *b)
+{
+  int order = by_size(a, b);
+  if (order) return order;
+  return memcmp((*(File *const *) a)->sample, (*(File *const *) b)->sample,
+                sizeof(((File *) 0)->sample));
+}
+
+int by_digest(const void *a, const void *b)
+{
+  int order = by_size(a, b);
+  if (order) return order;
+  return memcmp((*(File *const *) a)->digest, (*(File *const *) b)->digest,
+                sizeof(((File *) 0)->digest));
+}
+
+/* sorts the candidates and keeps those that share their key with another */
+size_t narrow(File **candidates, size_t count,
+              int (*cmp)(const void *, const void *))
+{
+  size_t kept = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (!candidates[i]->failed) candidates[kept++] = candidates[i];
+  }
+  count = kept;
+
+  qsort(candidates, count, sizeof(File *), cmp);
+
+  kept = 0;
+  for (size_t i = 0; i < count; ++i) {
+    bool same_prev = i > 0 && !cmp(&candidates[i - 1], &candidates[i]);
+    bool same_next = i + 1 < count && !cmp(&candidates[i], &candidates[i + 1]);
+    if (same_prev || same_next) candidates[kept++] = candidates[i];
+  }
+
+  return kept;
+}
+
+/* keeps one path to every file, since a file reached twice, through
+ * repeated paths or hard links, would otherwise be its own duplicate */
+size_t distinct(File **candidates, size_t count)
+{
+  qsort(candidates, count, sizeof(File *), by_inode);
+
+  size_t kept = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (kept && candidates[kept - 1]->dev == candidates[i]->dev
+        && candidates[kept - 1]->ino == candidates[i]->ino) continue;
+    candidates[kept++] = candidates[i];
+  }
+
+  return kept;
+}
+
+void usage(void)
+{
+  printf("Usage: ah1dupes [-z] [-j JOBS] PATH...\n"
+         "  -z  include empty files\n"
+         "  -j  files read at once (8)\n"
+         "Duplicate files are printed in groups separated by blank lines.\n"
+         "A file reached more than once, also through hard links, is listed once.\n");
+}
+
+int main(int argc, char **argv)
+{
+  int jobs = 8;
+
+  int c;
+  while ((c = getopt(argc, argv, "zj:h")) != -1) {
+    switch (c) {
+    case 'z': min_size = 0; break;
+    case 'j': jobs = atoi(optarg); break;
+    default: usage(); return EXIT_FAILURE;
+    }
+  }
+
+  if (optind == argc || jobs < 1) {
+    usage();
+    return EXIT_FAILURE;
+  }
+
+  int status = EXIT_SUCCESS;
+  for (int i = optind; i < argc; ++i) {
+    if (nftw(argv[i], collect, MAX_FDS, FTW_PHYS) == -1) {
+      warn(argv[i]);
+      status = EXIT_FAILURE;
+    }
+  }
+
+  struct sigaction bus = { .sa_handler = on_bus };
+  sigemptyset(&bus.sa_mask);
+  if (sigaction(SIGBUS, &bus, NULL) == -1) die("Unable to handle SIGBUS.");
+
+  File **candidates = malloc((file_count ? file_count : 1) * sizeof(File *));
+  if (!candidates) die("Unable to allocate candidates.");
+  for (size_t i = 0; i < file_count; ++i) candidates[i] = &files[i];
+
+  size_t count = distinct(candidates, file_count);
+  size_t listed = count;
+  count = narrow(candidates, count, by_size);
+  size_t same_size = count;
+
+  run_stage(sample_file, candidates, count, jobs);
+  count = narrow(candidates, count, by_sample);
+  size_t same_sample = count;
+
+  /* empty files need no reading to be equal */
+  size_t start = 0;
+  while (start < count && !candidates[start]->size) start++;
+  run_stage(digest_file, candidates + start, count - start, jobs);
+  count = narrow(candidates, count, by_digest);
+
+  for (size_t i = 0; i < count; ++i) {
+    if (i > 0 && by_digest(&candidates[i - 1], &candidates[i])) printf("\n");
+    printf("%s\n", candidates[i]->path);
+  }
+
+  fprintf(stderr, "ah1dupes: %zu files, %zu sampled, %zu fully hashed, "
+          "%zu duplicates\n", listed, same_size, same_sample, count);
+
+  for (size_t i = 0; i < file_count; ++i) free(files[i].path);
+  free(files);
+  free(candidates);
+  return status;
+}
@@ -0,0 +1,179 @@
+/* -- hll.c
+ * Utility program to test the accuracy of AH2Hll estimates across sparse
+ * and dense sketches, and that merged sketches match a single one.
+ *
+ * MIT License
+ * 
+ * Copyright (c) 2025 Abhigyan <nourr@duck.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <AH1.h>
+
+#include <math.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#define PRECISION 14
+
+/* define max reading limits */
+#define MAX_LINE_LENGTH 1024
+
+#ifndef SHARDS
+#define SHARDS 1024
+#endif
+
+double seconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* relative error allowed: six standard errors of a dense sketch */
+double tolerance(void)
+{
+  return 6 * 1.04 / sqrt((double) (1 << PRECISION));
+}
+
+/* keys are the bytes of k, or text such as user123 whose digest words repeat */
+void test_cardinality(uint64_t count, bool text)
+{
+  AH2Hll *hll = AH2HllCreate(PRECISION);
+  AH2Hll *low = AH2HllCreate(PRECISION);
+  AH2Hll *high = AH2HllCreate(PRECISION);
+  assert(hll && low && high);
+
+  /* every key is added twice, and the halves overlap in the middle */
+  char buff[32];
+  for (uint64_t k = 0; k < count; ++k) {
+    const char *key = text ? buff : (const char *) &k;
+    size_t size = text ? (size_t) snprintf(buff, sizeof(buff), "user%" PRIu64, k)
+                       : sizeof(k);
+    assert(!AH2HllAdd(hll, key, size));
+    assert(!AH2HllAdd(hll, key, size));
+    if (k < count * 2 / 3) assert(!AH2HllAdd(low, key, size));
+    if (k >= count / 3) assert(!AH2HllAdd(high, key, size));
+  }
+
+  double estimate = AH2HllEstimate(hll);
+  double error = fabs(estimate - count) / count;
+  printf("CARDINALITY %10" PRIu64 " %s: estimate %12.1f (%.3f%%)\n",
+         count, text ? "text keys" : "int keys ", estimate, 100 * error);
+  assert(error < tolerance() && "TEST FAILED: ESTIMATE OUT OF BOUNDS.");
+
+  assert(!AH2HllMerge(low, high));
+  assert(AH2HllEstimate(low) == estimate && "TEST FAILED: MERGE DIFFERS.");
+
+  AH2HllDestroy(hll);
+  AH2HllDestroy(low);
+  AH2HllDestroy(high);
+}
+
+void test_words(const char *path)
+{
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    perror("Unable to open given file.");
+    exit(-1);
+  }
+
+  AH2Hll *hll = AH2HllCreate(PRECISION);
+  assert(hll);
+
+  char buff[MAX_LINE_LENGTH];
+  const char *keys[64];
+  size_t sizes[64];
+  char words[64][MAX_LINE_LENGTH];
+  size_t n = 0, count = 0;
+  while (fgets(buff, MAX_LINE_LENGTH, file)) {
+    sizes[n] = strcspn(buff, "\n");
+    memcpy(words[n], buff, sizes[n]);
+    keys[n] = words[n];
+    count++;
+    if (++n == 64) {
+      assert(!AH2HllAddBulk(hll, keys, sizes, n));
+      n = 0;
+    }
+  }
+  assert(!AH2HllAddBulk(hll, keys, sizes, n));
+  fclose(file);
+
+  double estimate = AH2HllEstimate(hll);
+  double error = fabs(estimate - count) / count;
+  printf("[%s] %zu words: estimate %.1f (%.3f%%)\n", path, count, estimate, 100 * error);
+  assert(error < tolerance() && "TEST FAILED: ESTIMATE OUT OF BOUNDS.");
+
+  AH2HllDestroy(hll);
+}
+
+void bench_merge(void)
+{
+  AH2Hll **shards = malloc(SHARDS * sizeof(AH2Hll *));
+  AH2Hll *total = AH2HllCreate(PRECISION);
+  assert(shards && total);
+
+  for (uint64_t s = 0; s < SHARDS; ++s) {
+    shards[s] = AH2HllCreate(PRECISION);
+    assert(shards[s]);
+    for (uint64_t k = 0; k < 1 << PRECISION; ++k) {
+      uint64_t key = s << 32 | k;
+      assert(!AH2HllAdd(shards[s], (const char *) &key, sizeof(key)));
+    }
+  }
+
+  double start = seconds();
+  for (int s = 0; s < SHARDS; ++s) assert(!AH2HllMerge(total, shards[s]));
+  double elapsed = seconds() - start;
+
+  double count = (double) SHARDS * (1 << PRECISION);
+  double error = fabs(AH2HllEstimate(total) - count) / count;
+  printf("MERGE %d DENSE SHARDS: %.2f GB/s of registers (%.3f%%)\n", SHARDS,
+         SHARDS * (double) (1 << PRECISION) / elapsed / 1e9, 100 * error);
+  assert(error < tolerance() && "TEST FAILED: ESTIMATE OUT OF BOUNDS.");
+
+  for (int s = 0; s < SHARDS; ++s) AH2HllDestroy(shards[s]);
+  AH2HllDestroy(total);
+  free(shards);
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2) {
+    printf("Usage: test_hll [FILE NAME]\n");
+    return -1;
+  }
+
+  uint64_t counts[] = { 1, 10, 100, 1000, 3000, 10000, 100000, 1000000, 10000000 };
+  for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); ++i) {
+    test_cardinality(counts[i], false);
+  }
+  test_cardinality(1 << 22, true);
+  test_cardinality(1 << 24, true);
+
+  test_words(argv[1]);
+  bench_merge();
+  return 0;
+}
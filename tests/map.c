@@ -0,0 +1,209 @@
+/* -- map.c
+ * Utility program to test AH2Map under concurrent inserts of duplicate
+ * digests and to measure how its throughput scales with threads.
+ *
+ * MIT License
+ * 
+ * Copyright (c) 2025 Abhigyan <nourr@duck.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <AH1.h>
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include <inttypes.h>
+
+#ifndef KEYS
+#define KEYS (1 << 20)
+#endif
+
+/* enough text keys for single digest words to repeat many times over */
+#ifndef TEXT_KEYS
+#define TEXT_KEYS (1 << 22)
+#endif
+
+typedef struct Worker
+{
+  pthread_t thread;
+  AH2Map *map;
+  uint64_t (*digests)[4];
+  size_t keys;
+  size_t begin;
+  size_t end;
+  size_t added;
+} Worker;
+
+double seconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void *insert_slice(void *arg)
+{
+  Worker *worker = arg;
+  for (size_t r = worker->begin; r < worker->end; ++r) {
+    size_t k = r % worker->keys;
+    int added = AH2MapInsert(worker->map, worker->digests[k], k);
+    assert(added >= 0 && "TEST FAILED: MAP COULD NOT GROW.");
+    worker->added += added;
+
+    /* the map is resizing during most of the run, and keys inserted
+     * before must stay visible while their slots are being moved */
+    assert(AH2MapFind(worker->map, worker->digests[k], NULL)
+           && "TEST FAILED: INSERTED DIGEST NOT FOUND DURING RESIZE.");
+    size_t earlier = (r - worker->begin) / 2 + worker->begin;
+    assert(AH2MapFind(worker->map, worker->digests[earlier % worker->keys], NULL)
+           && "TEST FAILED: EARLIER DIGEST NOT FOUND DURING RESIZE.");
+  }
+
+  return NULL;
+}
+
+/* every key appears twice in the stream, in different threads' slices */
+double run(uint64_t (*digests)[4], size_t keys, int threads)
+{
+  size_t records = 2 * keys;
+  AH2Map *map = AH2MapCreate(0);
+  Worker *workers = calloc(threads, sizeof(Worker));
+  assert(map && workers);
+
+  double start = seconds();
+  for (int t = 0; t < threads; ++t) {
+    workers[t].map = map;
+    workers[t].digests = digests;
+    workers[t].keys = keys;
+    workers[t].begin = records * t / threads;
+    workers[t].end = records * (t + 1) / threads;
+    if (pthread_create(&workers[t].thread, NULL, insert_slice, &workers[t])) {
+      perror("Unable to start worker thread.");
+      exit(-1);
+    }
+  }
+
+  size_t added = 0;
+  for (int t = 0; t < threads; ++t) {
+    pthread_join(workers[t].thread, NULL);
+    added += workers[t].added;
+  }
+  double elapsed = seconds() - start;
+
+  assert(added == keys && "TEST FAILED: DUPLICATE ADDED OR DIGEST LOST.");
+  assert(AH2MapSize(map) == keys);
+  for (size_t k = 0; k < keys; ++k) {
+    uint64_t value;
+    assert(AH2MapFind(map, digests[k], &value) && value == k);
+  }
+
+  uint64_t missing[4] = { 0 };
+  assert(!AH2MapFind(map, missing, NULL));
+
+  AH2MapDestroy(map);
+  free(workers);
+  return elapsed;
+}
+
+/* random digests, as AH2Hash would give for arbitrary keys */
+void random_digest(uint64_t *state, uint64_t digest[4])
+{
+  for (int w = 0; w < 4; ++w) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    digest[w] = z ^ (z >> 31);
+  }
+}
+
+/*
+ * A digest that sits in the last slot of the first migration chunk is
+ * looked up right after that chunk moved, while the slot after it is still
+ * empty and waiting in the next chunk. Relies on the first table having
+ * 4096 slots migrated 1024 at a time, over 64 stripes of 32 digests each.
+ */
+void test_find_during_resize(void)
+{
+  uint64_t state = 1, edge[4], folded[2];
+  do {
+    random_digest(&state, edge);
+    AH2Fold(edge, folded);
+  } while (folded[0] >> 52 != 1023);
+
+  AH2Map *map = AH2MapCreate(0);
+  assert(map && AH2MapInsert(map, edge, 1) == 1);
+
+  /* fill one stripe far from the edge slot until it starts a resize */
+  for (int added = 0; added < 33;) {
+    uint64_t digest[4];
+    random_digest(&state, digest);
+    AH2Fold(digest, folded);
+    if (((folded[0] >> 2) & 63) != 0 || folded[0] >> 52 < 2048) continue;
+    assert(AH2MapInsert(map, digest, 0) == 1);
+    added++;
+  }
+
+  assert(AH2MapFind(map, edge, NULL) && "TEST FAILED: DIGEST LOST DURING RESIZE.");
+  AH2MapDestroy(map);
+}
+
+int main(int argc, char **argv)
+{
+  int max_threads = argc > 1 ? atoi(argv[1]) : 8;
+  if (max_threads < 1) {
+    printf("Usage: test_map [MAX THREADS]\n");
+    return -1;
+  }
+
+  test_find_during_resize();
+  printf("FIND DURING RESIZE: ok\n");
+
+  assert(!AH2MapCreate(SIZE_MAX) && "TEST FAILED: HUGE MAP CREATED.");
+
+  uint64_t (*digests)[4] = malloc(TEXT_KEYS * sizeof(*digests));
+  assert(digests);
+
+  /* text keys such as user123 give digests whose words repeat across keys */
+  char text[32];
+  for (uint64_t k = 0; k < TEXT_KEYS; ++k) {
+    int size = snprintf(text, sizeof(text), "user%" PRIu64, k);
+    AH2Hash(text, size, digests[k]);
+  }
+  run(digests, TEXT_KEYS, 1);
+  printf("INSERT %d TEXT KEYS: all distinct\n", TEXT_KEYS);
+
+  for (uint64_t k = 0; k < KEYS; ++k) {
+    AH2Hash((const char *) &k, sizeof(k), digests[k]);
+  }
+
+  double base = 0;
+  for (int threads = 1; threads <= max_threads; threads *= 2) {
+    double elapsed = run(digests, KEYS, threads);
+    if (threads == 1) base = elapsed;
+    printf("INSERT %d RECORDS, %2d THREADS: %6.1f Mops/s (x%.2f)\n",
+           2 * KEYS, threads, 2 * KEYS / elapsed / 1e6, base / elapsed);
+  }
+
+  free(digests);
+  return 0;
+}
@@ -0,0 +1,211 @@
+/* -- perfect.c
+ * Utility program to test AH1Perfect over word lists, through a saved and
+ * mapped copy, and to measure build time and size on a large key set.
+ *
+ * MIT License
+ * 
+ * Copyright (c) 2025 Abhigyan <nourr@duck.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <AH1.h>
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+/* define max reading limits */
+#define MAX_LINE_LENGTH 1024
+
+#ifndef BENCH_KEYS
+#define BENCH_KEYS (1 << 22)
+#endif
+
+double seconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* asserts that every key maps to a distinct index below count */
+void check_indices(const AH1Perfect *perfect, char **keys, size_t *sizes, size_t count)
+{
+  uint8_t *seen = calloc(count, 1);
+  assert(seen);
+  assert(AH1PerfectKeys(perfect) == count);
+
+  for (size_t i = 0; i < count; ++i) {
+    uint64_t index = AH1PerfectIndex(perfect, keys[i], sizes[i]);
+    assert(index < count && "TEST FAILED: INDEX OUT OF RANGE.");
+    assert(!seen[index] && "TEST FAILED: TWO KEYS SHARE AN INDEX.");
+    seen[index] = 1;
+  }
+
+  free(seen);
+}
+
+/* writes a saved function back with one field overwritten and asserts that
+ * loading it fails; fields are at their offsets in the file layout */
+void expect_corrupt(const char *saved, size_t at, const void *field, size_t size)
+{
+  FILE *file = fopen(saved, "rb");
+  assert(file);
+  fseek(file, 0, SEEK_END);
+  size_t bytes = ftell(file);
+  rewind(file);
+  char *data = malloc(bytes);
+  assert(data && fread(data, 1, bytes, file) == bytes);
+  fclose(file);
+
+  char corrupt[1024];
+  snprintf(corrupt, sizeof(corrupt), "%s.corrupt", saved);
+  memcpy(data + at, field, size);
+  file = fopen(corrupt, "wb");
+  assert(file && fwrite(data, 1, bytes, file) == bytes);
+  fclose(file);
+
+  assert(!AH1PerfectLoad(corrupt) && "TEST FAILED: CORRUPT FILE LOADED.");
+  unlink(corrupt);
+  free(data);
+}
+
+void test_corrupt(const char *saved)
+{
+  /* header: magic, order, keys, partitions, buckets, exceptions, remapped;
+   * the first partition follows at 56: offset, pilots, remapped, exceptions,
+   * then exception count, keys, slots, buckets and dense as 32-bit fields */
+  uint64_t huge = UINT64_MAX / 2;
+  uint32_t none = 0, most = UINT32_MAX;
+  expect_corrupt(saved, 24, &huge, sizeof(huge));
+  expect_corrupt(saved, 56, &huge, sizeof(huge));
+  expect_corrupt(saved, 64, &huge, sizeof(huge));
+  expect_corrupt(saved, 72, &huge, sizeof(huge));
+  expect_corrupt(saved, 80, &huge, sizeof(huge));
+  expect_corrupt(saved, 88, &most, sizeof(most));
+  expect_corrupt(saved, 96, &none, sizeof(none));
+}
+
+void test_words(const char *path, const char *saved)
+{
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    perror("Unable to open given file.");
+    exit(-1);
+  }
+
+  size_t count = 0, cap = 1024;
+  char **keys = malloc(cap * sizeof(char *));
+  size_t *sizes = malloc(cap * sizeof(size_t));
+  char buff[MAX_LINE_LENGTH];
+  while (fgets(buff, MAX_LINE_LENGTH, file)) {
+    if (count == cap) {
+      cap *= 2;
+      keys = realloc(keys, cap * sizeof(char *));
+      sizes = realloc(sizes, cap * sizeof(size_t));
+    }
+    assert(keys && sizes);
+
+    sizes[count] = strcspn(buff, "\n");
+    keys[count] = strdup(buff);
+    assert(keys[count]);
+    count++;
+  }
+  fclose(file);
+
+  AH1Perfect *perfect = AH1PerfectBuild((const char *const *) keys, sizes, count, 4);
+  assert(perfect && "TEST FAILED: BUILD FAILED.");
+  check_indices(perfect, keys, sizes, count);
+  assert(!AH1PerfectSave(perfect, saved));
+
+  AH1Perfect *loaded = AH1PerfectLoad(saved);
+  assert(loaded && AH1PerfectBytes(loaded) == AH1PerfectBytes(perfect));
+  for (size_t i = 0; i < count; ++i) {
+    assert(AH1PerfectIndex(loaded, keys[i], sizes[i]) ==
+           AH1PerfectIndex(perfect, keys[i], sizes[i]));
+  }
+  test_corrupt(saved);
+
+  /* a repeated key can not be given an index of its own */
+  sizes[count - 1] = sizes[0];
+  keys[count - 1][0] = '\0';
+  memcpy(keys[count - 1], keys[0], sizes[0]);
+  assert(!AH1PerfectBuild((const char *const *) keys, sizes, count, 1));
+
+  printf("[%s] %zu keys, %.2f bits/key\n", path, count,
+         8.0 * AH1PerfectBytes(perfect) / count);
+
+  AH1PerfectDestroy(perfect);
+  AH1PerfectDestroy(loaded);
+  unlink(saved);
+  for (size_t i = 0; i < count; ++i) free(keys[i]);
+  free(keys);
+  free(sizes);
+}
+
+void bench(void)
+{
+  uint64_t *ids = malloc(BENCH_KEYS * sizeof(uint64_t));
+  char **keys = malloc(BENCH_KEYS * sizeof(char *));
+  size_t *sizes = malloc(BENCH_KEYS * sizeof(size_t));
+  assert(ids && keys && sizes);
+
+  for (size_t i = 0; i < BENCH_KEYS; ++i) {
+    ids[i] = i;
+    keys[i] = (char *) &ids[i];
+    sizes[i] = sizeof(uint64_t);
+  }
+
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  double start = seconds();
+  AH1Perfect *perfect = AH1PerfectBuild((const char *const *) keys, sizes,
+                                        BENCH_KEYS, threads);
+  double build = seconds() - start;
+  assert(perfect && "TEST FAILED: BUILD FAILED.");
+
+  start = seconds();
+  check_indices(perfect, keys, sizes, BENCH_KEYS);
+  double lookup = seconds() - start;
+
+  printf("BUILD %d KEYS, %ld THREADS: %.2fs, %.2f bits/key, %.1f Mlookups/s\n",
+         BENCH_KEYS, threads, build, 8.0 * AH1PerfectBytes(perfect) / BENCH_KEYS,
+         BENCH_KEYS / lookup / 1e6);
+
+  AH1PerfectDestroy(perfect);
+  free(ids);
+  free(keys);
+  free(sizes);
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 3) {
+    printf("Usage: test_perfect [FILE NAME] [SAVE PATH]\n");
+    return -1;
+  }
+
+  test_words(argv[1], argv[2]);
+  bench();
+  return 0;
+}
@@ -1,6 +1,8 @@
 /* -- repl.c
  * A REPL to compute hashes of strings.
  *
+ * Lines can also be hashed in batch from a pipeline, with -b.
+ *
  * MIT License
  * 
  * Copyright (c) 2025 Abhigyan <nourr@duck.com>
@@ -27,14 +29,57 @@
 #include <AH1.h>
 
 #include <stdio.h>
+#include <errno.h>
 #include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <inttypes.h>
 
 #define EXIT_SUCCESS 0
 #define EXIT_FAILURE 1
 
-#define BUFF_SIZE 2048
+/* default size of the blocks stdin is read in, in batch mode */
+#define BLOCK_SIZE (1 << 20)
+
+/* lengths of a formatted AH1Hash and AH2Hash digest */
+#define AH1_HEX 32
+#define AH2_HEX 64
+
+enum { JOB_FREE, JOB_FILLED, JOB_DONE };
+
+/* a block of whole lines and the formatted digests of those lines */
+typedef struct Job
+{
+  char *in;
+  size_t in_cap;
+  size_t in_used;
+  char *out;
+  size_t out_cap;
+  size_t out_used;
+  int state;
+} Job;
+
+typedef struct Options
+{
+  size_t block;
+  int threads;
+  bool raw;
+  bool ah1;
+  bool ah2;
+} Options;
+
+static Options opts;
+static Job *jobs;
+static size_t ring;
+static size_t filled, taken, written;
+static bool input_done;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t changed = PTHREAD_COND_INITIALIZER;
+
+/* two hex digits for every byte value */
+static char hex_pairs[256][2];
 
 void ah1_print(uint32_t hash[4])
 {
@@ -54,23 +99,319 @@ void ah2_print(uint64_t hash[4])
   printf("\n");
 }
 
+void die(const char *message)
+{
+  perror(message);
+  exit(EXIT_FAILURE);
+}
+
+void write_all(int fd, const char *bytes, size_t size)
+{
+  while (size) {
+    ssize_t n = write(fd, bytes, size);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      die("file i/o: cannot write.");
+    }
+    bytes += n;
+    size -= n;
+  }
+}
+
+/* read until size bytes are in or the input ends */
+size_t read_full(int fd, char *bytes, size_t size)
+{
+  size_t got = 0;
+  while (got < size) {
+    ssize_t n = read(fd, bytes + got, size - got);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      die("file i/o: cannot read input.");
+    }
+    if (!n) break;
+    got += n;
+  }
+
+  return got;
+}
+
+void reserve(char **buff, size_t *cap, size_t size)
+{
+  if (size <= *cap) return;
+  size_t grown = *cap ? *cap : 4096;
+  while (grown < size) grown *= 2;
+  *buff = realloc(*buff, grown);
+  if (!*buff) die("Unable to allocate buffer.");
+  *cap = grown;
+}
+
+/* formatted bytes per line, including the newline of hex output */
+size_t record_size(void)
+{
+  if (opts.raw)
+    return (opts.ah1 ? 4 * sizeof(uint32_t) : 0)
+         + (opts.ah2 ? 4 * sizeof(uint64_t) : 0);
+
+  return (opts.ah1 ? AH1_HEX : 0) + (opts.ah2 ? AH2_HEX : 0)
+       + (opts.ah1 && opts.ah2) + 1;
+}
+
+/* zero padded, most significant digit first, so every digest has one width */
+static inline char *hex32(char *out, uint32_t word)
+{
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    memcpy(out, hex_pairs[(word >> shift) & 0xff], 2);
+    out += 2;
+  }
+  return out;
+}
+
+static inline char *hex64(char *out, uint64_t word)
+{
+  out = hex32(out, word >> 32);
+  return hex32(out, (uint32_t) word);
+}
+
+char *format(char *out, const uint32_t ah1[4], const uint64_t ah2[4])
+{
+  if (opts.raw) {
+    if (opts.ah1) { memcpy(out, ah1, 4 * sizeof(uint32_t)); out += 4 * sizeof(uint32_t); }
+    if (opts.ah2) { memcpy(out, ah2, 4 * sizeof(uint64_t)); out += 4 * sizeof(uint64_t); }
+    return out;
+  }
+
+  if (opts.ah1) for (int i = 0; i < 4; ++i) out = hex32(out, ah1[i]);
+  if (opts.ah1 && opts.ah2) *out++ = ' ';
+  if (opts.ah2) for (int i = 0; i < 4; ++i) out = hex64(out, ah2[i]);
+  *out++ = '\n';
+  return out;
+}
+
+/* hash the lines of a block in place; only the last line of input may lack a newline */
+void hash_job(Job *job)
+{
+  uint32_t ah1[4] = { 0 };
+  uint64_t ah2[4] = { 0 };
+  size_t record = record_size();
+  char *line = job->in, *end = job->in + job->in_used;
+
+  job->out_used = 0;
+  while (line < end) {
+    char *newline = memchr(line, '\n', end - line);
+    size_t size = (newline ? newline : end) - line;
+
+    reserve(&job->out, &job->out_cap, job->out_used + record);
+    if (opts.ah1) AH1Hash(line, size, ah1);
+    if (opts.ah2) AH2Hash(line, size, ah2);
+    job->out_used = format(job->out + job->out_used, ah1, ah2) - job->out;
+
+    line += size + 1;
+  }
+}
+
+void *hash_worker(void *arg)
+{
+  (void) arg;
+  pthread_mutex_lock(&lock);
+  for (;;) {
+    while (taken == filled && !input_done) pthread_cond_wait(&changed, &lock);
+    if (taken == filled) break;
+
+    Job *job = &jobs[taken++ % ring];
+    pthread_mutex_unlock(&lock);
+    hash_job(job);
+    pthread_mutex_lock(&lock);
+    job->state = JOB_DONE;
+    pthread_cond_broadcast(&changed);
+  }
+  pthread_mutex_unlock(&lock);
+  return NULL;
+}
+
+/* writes blocks in input order, whichever worker finished them first */
+void *write_worker(void *arg)
+{
+  (void) arg;
+  pthread_mutex_lock(&lock);
+  for (;;) {
+    Job *job = &jobs[written % ring];
+    while (job->state != JOB_DONE && !(input_done && written == filled))
+      pthread_cond_wait(&changed, &lock);
+    if (job->state != JOB_DONE) break;
+
+    pthread_mutex_unlock(&lock);
+    write_all(STDOUT_FILENO, job->out, job->out_used);
+    pthread_mutex_lock(&lock);
+    job->state = JOB_FREE;
+    written++;
+    pthread_cond_broadcast(&changed);
+  }
+  pthread_mutex_unlock(&lock);
+  return NULL;
+}
+
+/*
+ * Fills the ring with blocks that end on a newline. The partial line at the
+ * end of a block is carried into the next one, and a line longer than a block
+ * grows its buffer until the newline shows up.
+ */
+void read_input(int fd)
+{
+  const char *carry = NULL;
+  size_t carry_size = 0;
+  bool eof = false;
+
+  while (!eof) {
+    Job *job = &jobs[filled % ring];
+    pthread_mutex_lock(&lock);
+    while (job->state != JOB_FREE) pthread_cond_wait(&changed, &lock);
+    pthread_mutex_unlock(&lock);
+
+    reserve(&job->in, &job->in_cap, carry_size + opts.block);
+    memcpy(job->in, carry, carry_size);
+    size_t used = carry_size, lines_end = 0;
+
+    for (;;) {
+      reserve(&job->in, &job->in_cap, used + opts.block);
+      size_t n = read_full(fd, job->in + used, opts.block);
+      if (!n) {
+        eof = true;
+        lines_end = used;
+        break;
+      }
+
+      size_t scanned = used;
+      used += n;
+      for (size_t i = used; i > scanned; --i) {
+        if (job->in[i - 1] == '\n') {
+          lines_end = i;
+          break;
+        }
+      }
+      if (lines_end) break;
+    }
+
+    job->in_used = lines_end;
+    carry = job->in + lines_end;
+    carry_size = used - lines_end;
+
+    pthread_mutex_lock(&lock);
+    job->state = JOB_FILLED;
+    filled++;
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&lock);
+  }
+
+  pthread_mutex_lock(&lock);
+  input_done = true;
+  pthread_cond_broadcast(&changed);
+  pthread_mutex_unlock(&lock);
+}
+
+int batch(void)
+{
+  for (int i = 0; i < 256; ++i) {
+    hex_pairs[i][0] = "0123456789abcdef"[i >> 4];
+    hex_pairs[i][1] = "0123456789abcdef"[i & 15];
+  }
+
+  /* every worker hashes one block while the reader and writer hold others */
+  ring = 2 * (size_t) opts.threads + 2;
+  jobs = calloc(ring, sizeof(Job));
+  pthread_t *threads = malloc((opts.threads + 1) * sizeof(pthread_t));
+  if (!jobs || !threads) die("Unable to allocate threads.");
+
+  for (int t = 0; t < opts.threads; ++t) {
+    if (pthread_create(&threads[t], NULL, hash_worker, NULL))
+      die("Unable to start worker thread.");
+  }
+  if (pthread_create(&threads[opts.threads], NULL, write_worker, NULL))
+    die("Unable to start writer thread.");
+
+  read_input(STDIN_FILENO);
+  for (int t = 0; t <= opts.threads; ++t) pthread_join(threads[t], NULL);
+
+  for (size_t i = 0; i < ring; ++i) {
+    free(jobs[i].in);
+    free(jobs[i].out);
+  }
+  free(jobs);
+  free(threads);
+  return EXIT_SUCCESS;
+}
+
+size_t parse_size(const char *arg)
+{
+  char *end;
+  size_t size = strtoull(arg, &end, 10);
+  switch (*end) {
+  case 'G': case 'g': size <<= 10; /* fall through */
+  case 'M': case 'm': size <<= 10; /* fall through */
+  case 'K': case 'k': size <<= 10; break;
+  case '\0': break;
+  default: size = 0;
+  }
+
+  return size;
+}
+
+void usage(void)
+{
+  printf("Usage: repl [-b] [-r] [-1 | -2] [-j THREADS] [-s BLOCK]\n"
+         "  -b  batch mode: hash every line of stdin, without its newline\n"
+         "  -r  write raw digests in native byte order instead of hex lines\n"
+         "  -1  write only the AH1Hash digest\n"
+         "  -2  write only the AH2Hash digest\n"
+         "  -j  threads hashing blocks (online processors)\n"
+         "  -s  size of the blocks stdin is read in, with a K, M or G suffix (1M)\n"
+         "Batch output is one digest line per input line, in input order, with\n"
+         "every word zero padded. Without -b the REPL prompts for each line.\n");
+}
+
 int main(int argc, char **argv)
 {
+  bool interactive = true;
+  opts.block = BLOCK_SIZE;
+  opts.threads = sysconf(_SC_NPROCESSORS_ONLN);
+  opts.ah1 = opts.ah2 = true;
+
+  int c;
+  while ((c = getopt(argc, argv, "br12j:s:h")) != -1) {
+    switch (c) {
+    case 'b': interactive = false; break;
+    case 'r': opts.raw = true; break;
+    case '1': opts.ah2 = false; opts.ah1 = true; break;
+    case '2': opts.ah1 = false; opts.ah2 = true; break;
+    case 'j': opts.threads = atoi(optarg); break;
+    case 's': opts.block = parse_size(optarg); break;
+    default: usage(); return EXIT_FAILURE;
+    }
+  }
+
+  if (!opts.block || opts.threads < 1) {
+    usage();
+    return EXIT_FAILURE;
+  }
+
+  if (!interactive) return batch();
+
   uint32_t hash32[4];
   uint64_t hash64[4];
-  char buff[BUFF_SIZE] = { 0 };
+  char *buff = NULL;
+  size_t cap = 0;
+  ssize_t size;
 
   printf(">> ");
-  while (fgets(buff, BUFF_SIZE, stdin)) {
+  while ((size = getline(&buff, &cap, stdin)) != -1) {
 
-    AH1Hash(buff, strlen(buff), hash32);
-    AH2Hash(buff, strlen(buff), hash64);
+    AH1Hash(buff, size, hash32);
+    AH2Hash(buff, size, hash64);
 
     ah1_print(hash32);
     ah2_print(hash64);
     printf(">> ");
   }
 
+  free(buff);
   return EXIT_SUCCESS;
 }
-
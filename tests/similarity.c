@@ -0,0 +1,211 @@
+/* -- similarity.c
+ * Utility program to test MinHash and SimHash signatures against exact
+ * shingle overlap, and that the LSH index finds edited copies of documents.
+ *
+ * MIT License
+ * 
+ * Copyright (c) 2025 Abhigyan <nourr@duck.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <AH1.h>
+
+#include <math.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/* define max reading limits */
+#define MAX_LINE_LENGTH 1024
+
+#define DOCS 400
+#define WORDS_PER_DOC 200
+#define EDITS 6
+#define WIDTH 8
+#define BANDS 32
+#define ROWS 4
+#define K (BANDS * ROWS)
+
+typedef struct Doc
+{
+  char *text;
+  size_t size;
+  uint64_t signature[K];
+  uint64_t simhash;
+} Doc;
+
+double seconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+char **read_words(const char *path, size_t *count)
+{
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    perror("Unable to open given file.");
+    exit(-1);
+  }
+
+  size_t cap = 1024;
+  char **words = malloc(cap * sizeof(char *));
+  char buff[MAX_LINE_LENGTH];
+  *count = 0;
+  while (words && fgets(buff, MAX_LINE_LENGTH, file)) {
+    if (*count == cap) words = realloc(words, (cap *= 2) * sizeof(char *));
+    assert(words);
+    buff[strcspn(buff, "\n")] = '\0';
+    words[(*count)++] = strdup(buff);
+  }
+  fclose(file);
+
+  assert(words && *count >= DOCS * WORDS_PER_DOC + DOCS * EDITS);
+  return words;
+}
+
+/* joins words[first..] into a document, swapping every stride-th word */
+Doc make_doc(char **words, size_t first, size_t stride, char **swaps)
+{
+  Doc doc = { 0 };
+  size_t cap = 0;
+  char **swap = swaps;
+  for (size_t i = 0; i < WORDS_PER_DOC; ++i) {
+    const char *word = words[first + i];
+    if (stride && i % stride == stride / 2) word = *swap++;
+    cap += strlen(word) + 1;
+  }
+
+  doc.text = malloc(cap);
+  assert(doc.text);
+  for (size_t i = 0; i < WORDS_PER_DOC; ++i) {
+    const char *word = words[first + i];
+    if (stride && i % stride == stride / 2) word = *swaps++;
+    size_t len = strlen(word);
+    memcpy(doc.text + doc.size, word, len);
+    doc.text[doc.size + len] = ' ';
+    doc.size += len + 1;
+  }
+
+  return doc;
+}
+
+void sign(Doc *doc)
+{
+  assert(!AH2MinHash(doc->text, doc->size, WIDTH, doc->signature, K));
+  doc->simhash = AH2SimHash(doc->text, doc->size, WIDTH);
+}
+
+/* exact Jaccard similarity of the shingle sets of two documents */
+double jaccard(const Doc *a, const Doc *b)
+{
+  AH1Table *table = AH1TableCreate(a->size + b->size);
+  assert(table);
+
+  for (size_t i = 0; i + WIDTH <= a->size; ++i) {
+    *AH1TableUpsert(table, a->text + i, WIDTH) |= 1;
+  }
+  for (size_t i = 0; i + WIDTH <= b->size; ++i) {
+    *AH1TableUpsert(table, b->text + i, WIDTH) |= 2;
+  }
+
+  size_t both = 0, either = AH1TableSize(table);
+  for (size_t i = 0; i + WIDTH <= a->size; ++i) {
+    uint64_t *cell = AH1TableFind(table, a->text + i, WIDTH);
+    if (*cell == 3) {
+      both++;
+      *cell = 0;
+    }
+  }
+
+  AH1TableDestroy(table);
+  return (double) both / either;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2) {
+    printf("Usage: test_similarity [FILE NAME]\n");
+    return -1;
+  }
+
+  size_t count;
+  char **words = read_words(argv[1], &count);
+  char **swaps = words + DOCS * WORDS_PER_DOC;
+
+  Doc *docs = malloc(DOCS * sizeof(Doc));
+  Doc *edited = malloc(DOCS * sizeof(Doc));
+  AH2Lsh *lsh = AH2LshCreate(BANDS, ROWS);
+  assert(docs && edited && lsh);
+
+  size_t bytes = 0;
+  double start = seconds();
+  for (size_t d = 0; d < DOCS; ++d) {
+    docs[d] = make_doc(words, d * WORDS_PER_DOC, 0, NULL);
+    edited[d] = make_doc(words, d * WORDS_PER_DOC, WORDS_PER_DOC / EDITS,
+                         swaps + d * EDITS);
+    sign(&docs[d]);
+    sign(&edited[d]);
+    bytes += docs[d].size + edited[d].size;
+    assert(!AH2LshInsert(lsh, docs[d].signature, d));
+  }
+  double elapsed = seconds() - start;
+
+  double worst = 0;
+  size_t found = 0, candidates = 0;
+  uint64_t matches[DOCS];
+  for (size_t d = 0; d < DOCS; ++d) {
+    const Doc *other = &docs[(d + 1) % DOCS];
+
+    double exact = jaccard(&docs[d], &edited[d]);
+    double estimate = AH2MinHashSimilarity(docs[d].signature, edited[d].signature, K);
+    if (fabs(exact - estimate) > worst) worst = fabs(exact - estimate);
+    assert(AH2MinHashSimilarity(docs[d].signature, other->signature, K) < 0.1);
+
+    unsigned int near = AH2SimHashDistance(docs[d].simhash, edited[d].simhash);
+    unsigned int far = AH2SimHashDistance(docs[d].simhash, other->simhash);
+    assert(near < far && "TEST FAILED: SIMHASH DOES NOT SEPARATE.");
+
+    size_t n = AH2LshQuery(lsh, edited[d].signature, matches, DOCS);
+    candidates += n;
+    for (size_t i = 0; i < n; ++i) found += matches[i] == d;
+  }
+
+  printf("MINHASH: worst error %.3f against exact Jaccard\n", worst);
+  printf("LSH: %zu/%d edited documents found, %.2f candidates per query\n",
+         found, DOCS, (double) candidates / DOCS);
+  printf("SIGNATURES: %.1f MB/s of text\n", bytes / elapsed / 1e6);
+  assert(worst < 0.15 && "TEST FAILED: MINHASH ESTIMATE OUT OF BOUNDS.");
+  assert(found >= DOCS * 95 / 100 && "TEST FAILED: LSH MISSED NEAR DUPLICATES.");
+
+  AH2LshDestroy(lsh);
+  for (size_t d = 0; d < DOCS; ++d) {
+    free(docs[d].text);
+    free(edited[d].text);
+  }
+  for (size_t i = 0; i < count; ++i) free(words[i]);
+  free(words);
+  free(docs);
+  free(edited);
+  return 0;
+}
@@ -0,0 +1,208 @@
+/* -- table.c
+ * Utility program to test the AH1Table bulk operations against word lists
+ * and to compare pipelined lookups with one-at-a-time lookups on a table
+ * larger than the cache.
+ *
+ * MIT License
+ * 
+ * Copyright (c) 2025 Abhigyan <nourr@duck.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <AH1.h>
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <inttypes.h>
+
+/* define max reading limits */
+#define MAX_LINE_LENGTH 1024
+
+/* 2^23 keys take a 512 MB table, more than the last level cache */
+#ifndef BENCH_KEYS
+#define BENCH_KEYS (1 << 23)
+#endif
+
+#define BATCH 256
+
+double seconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void test_words(const char *path)
+{
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    perror("Unable to open given file.");
+    exit(-1);
+  }
+
+  size_t count = 0, cap = 1024;
+  char **keys = malloc(cap * sizeof(char *));
+  size_t *sizes = malloc(cap * sizeof(size_t));
+  char buff[MAX_LINE_LENGTH];
+  while (fgets(buff, MAX_LINE_LENGTH, file)) {
+    if (count == cap) {
+      cap *= 2;
+      keys = realloc(keys, cap * sizeof(char *));
+      sizes = realloc(sizes, cap * sizeof(size_t));
+    }
+    assert(keys && sizes);
+
+    sizes[count] = strcspn(buff, "\n");
+    keys[count] = strdup(buff);
+    assert(keys[count]);
+    count++;
+  }
+  fclose(file);
+
+  AH1Table *table = AH1TableCreate(0);
+  uint64_t **cells = malloc(count * sizeof(uint64_t *));
+  assert(table && cells);
+
+  /* word lists may repeat words, so count occurrences rather than assign */
+  assert(!AH1TableUpsertBulk(table, (const char *const *) keys, sizes, count, cells));
+  for (size_t i = 0; i < count; ++i) (*cells[i])++;
+
+  size_t total = 0;
+  AH1TableFindBulk(table, (const char *const *) keys, sizes, count, cells);
+  for (size_t i = 0; i < count; ++i) {
+    assert(cells[i] && "TEST FAILED: INSERTED KEY NOT FOUND.");
+    assert(cells[i] == AH1TableFind(table, keys[i], sizes[i]));
+  }
+  for (size_t i = 0; i < count; ++i) {
+    uint64_t *cell = AH1TableFind(table, keys[i], sizes[i]);
+    total += *cell;
+    *cell = 0;
+  }
+  assert(total == count && "TEST FAILED: OCCURRENCE COUNT MISMATCH.");
+
+  /* a trailing newline turns every word into a key that was never added */
+  for (size_t i = 0; i < count; ++i) sizes[i]++;
+  AH1TableFindBulk(table, (const char *const *) keys, sizes, count, cells);
+  for (size_t i = 0; i < count; ++i) {
+    assert(!cells[i] && "TEST FAILED: MISSING KEY FOUND.");
+  }
+
+  printf("[%s] %zu distinct keys out of %zu\n", path, AH1TableSize(table), count);
+
+  AH1TableDestroy(table);
+  for (size_t i = 0; i < count; ++i) free(keys[i]);
+  free(keys);
+  free(sizes);
+  free(cells);
+}
+
+/* sizes no table can be allocated for fail instead of wrapping around */
+void test_limits(void)
+{
+  assert(!AH1TableCreate(SIZE_MAX) && "TEST FAILED: HUGE TABLE CREATED.");
+  assert(!AH1TableCreate(SIZE_MAX / 4) && "TEST FAILED: HUGE TABLE CREATED.");
+
+  AH1Table *table = AH1TableCreate(0);
+  assert(table);
+  assert(AH1TableUpsert(table, "key", 3));
+  assert(AH1TableReserve(table, SIZE_MAX) && "TEST FAILED: COUNT WRAPPED.");
+  assert(AH1TableReserve(table, SIZE_MAX / 2) && "TEST FAILED: HUGE RESERVE.");
+  assert(AH1TableFind(table, "key", 3) && AH1TableSize(table) == 1);
+  AH1TableDestroy(table);
+
+  printf("[limits] oversized tables refused\n");
+}
+
+/*
+ * A hash join: the build side's keys stay where they were inserted from,
+ * and the probe side streams through its own copies in another order, so
+ * both the bucket and the stored key are cold on every match.
+ */
+void bench(void)
+{
+  uint64_t *ids = malloc(BENCH_KEYS * sizeof(uint64_t));
+  uint64_t *probes = malloc(BENCH_KEYS * sizeof(uint64_t));
+  const char **keys = malloc(BENCH_KEYS * sizeof(char *));
+  size_t *sizes = malloc(BENCH_KEYS * sizeof(size_t));
+  uint64_t **cells = malloc(BATCH * sizeof(uint64_t *));
+  AH1Table *table = AH1TableCreate(BENCH_KEYS);
+  assert(ids && probes && keys && sizes && cells && table);
+
+  for (size_t i = 0; i < BENCH_KEYS; ++i) {
+    ids[i] = i * 0x9e3779b97f4a7c15;
+    keys[i] = (const char *) &ids[i];
+    sizes[i] = sizeof(uint64_t);
+  }
+
+  for (size_t i = 0; i < BENCH_KEYS; i += BATCH) {
+    assert(!AH1TableUpsertBulk(table, keys + i, sizes + i, BATCH, cells));
+    for (size_t j = 0; j < BATCH; ++j) *cells[j] = i + j;
+  }
+
+  srand(time(NULL));
+  memcpy(probes, ids, BENCH_KEYS * sizeof(uint64_t));
+  for (size_t i = BENCH_KEYS - 1; i > 0; --i) {
+    size_t j = (size_t) rand() % (i + 1);
+    uint64_t t = probes[i]; probes[i] = probes[j]; probes[j] = t;
+  }
+  for (size_t i = 0; i < BENCH_KEYS; ++i) keys[i] = (const char *) &probes[i];
+
+  uint64_t sum = 0;
+  double start = seconds();
+  for (size_t i = 0; i < BENCH_KEYS; ++i) {
+    sum += *AH1TableFind(table, keys[i], sizes[i]);
+  }
+  double single = seconds() - start;
+
+  start = seconds();
+  for (size_t i = 0; i < BENCH_KEYS; i += BATCH) {
+    AH1TableFindBulk(table, keys + i, sizes + i, BATCH, cells);
+    for (size_t j = 0; j < BATCH; ++j) sum -= *cells[j];
+  }
+  double bulk = seconds() - start;
+
+  assert(!sum && "TEST FAILED: BULK AND SINGLE LOOKUPS DISAGREE.");
+  printf("LOOKUP %d KEYS: single %.1f Mops/s, bulk %.1f Mops/s (x%.2f)\n",
+         BENCH_KEYS, BENCH_KEYS / single / 1e6, BENCH_KEYS / bulk / 1e6,
+         single / bulk);
+
+  AH1TableDestroy(table);
+  free(ids);
+  free(probes);
+  free(keys);
+  free(sizes);
+  free(cells);
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2) {
+    printf("Usage: test_table [FILE NAME]\n");
+    return -1;
+  }
+
+  test_words(argv[1]);
+  test_limits();
+  bench();
+  return 0;
+}